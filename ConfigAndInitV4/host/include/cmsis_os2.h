@@ -0,0 +1,136 @@
+#ifndef _CMSIS_OS2_H_
+#define _CMSIS_OS2_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host stand-in for the subset of CMSIS-RTOS2 used by this project.
+ *
+ * Types, constants and signatures match cmsis_os2.h, so the firmware
+ * sources compile unchanged. The implementation (cmsis_os2_host.c) runs the
+ * threads on a deterministic virtual tick, see os_host.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define osWaitForever 0xFFFFFFFFU   //!< Wait forever timeout value.
+
+#define osFlagsWaitAny 0x00000000U   //!< Wait for any flag (default).
+#define osFlagsWaitAll 0x00000001U   //!< Wait for all flags.
+#define osFlagsNoClear 0x00000002U   //!< Do not clear flags which have been specified to wait for.
+
+#define osFlagsError          0x80000000U   //!< Error indicator.
+#define osFlagsErrorUnknown   0xFFFFFFFFU   //!< osError (-1).
+#define osFlagsErrorTimeout   0xFFFFFFFEU   //!< osErrorTimeout (-2).
+#define osFlagsErrorResource  0xFFFFFFFDU   //!< osErrorResource (-3).
+#define osFlagsErrorParameter 0xFFFFFFFCU   //!< osErrorParameter (-4).
+#define osFlagsErrorISR       0xFFFFFFFAU   //!< osErrorISR (-6).
+
+typedef enum {
+	osOK             =  0,   //!< Operation completed successfully.
+	osError          = -1,   //!< Unspecified RTOS error.
+	osErrorTimeout   = -2,   //!< Operation not completed within the timeout period.
+	osErrorResource  = -3,   //!< Resource not available.
+	osErrorParameter = -4,   //!< Parameter error.
+	osErrorNoMemory  = -5,   //!< System is out of memory.
+	osErrorISR       = -6,   //!< Not allowed in ISR context.
+	osStatusReserved = 0x7FFFFFFF
+} osStatus_t;
+
+typedef enum {
+	osKernelInactive =  0,   //!< Inactive.
+	osKernelReady    =  1,   //!< Ready.
+	osKernelRunning  =  2,   //!< Running.
+	osKernelLocked   =  3,   //!< Locked.
+	osKernelSuspended = 4,   //!< Suspended.
+	osKernelError    = -1,   //!< Error.
+	osKernelReserved = 0x7FFFFFFF
+} osKernelState_t;
+
+typedef enum {
+	osPriorityNone         =  0,
+	osPriorityIdle         =  1,
+	osPriorityLow          =  8,
+	osPriorityBelowNormal  = 16,
+	osPriorityNormal       = 24,
+	osPriorityAboveNormal  = 32,
+	osPriorityHigh         = 40,
+	osPriorityRealtime     = 48,
+	osPriorityISR          = 56,
+	osPriorityError        = -1,
+	osPriorityReserved     = 0x7FFFFFFF
+} osPriority_t;
+
+typedef enum {
+	osTimerOnce     = 0,   //!< One-shot timer.
+	osTimerPeriodic = 1    //!< Repeating timer.
+} osTimerType_t;
+
+typedef void (*osThreadFunc_t)(void* argument);
+typedef void (*osTimerFunc_t)(void* argument);
+
+typedef void* osThreadId_t;
+typedef void* osTimerId_t;
+
+/**
+ * @brief Attributes structure for thread.
+ */
+typedef struct {
+	const char* name;     //!< Name of the thread.
+	uint32_t attr_bits;   //!< Attribute bits.
+	void*    cb_mem;      //!< Memory for control block.
+	uint32_t cb_size;     //!< Size of provided memory for control block.
+	void*    stack_mem;   //!< Memory for stack.
+	uint32_t stack_size;  //!< Size of stack.
+	osPriority_t priority;//!< Initial thread priority (default: osPriorityNormal).
+	uint32_t tz_module;   //!< TrustZone module identifier.
+	uint32_t reserved;    //!< Reserved (must be 0).
+} osThreadAttr_t;
+
+/**
+ * @brief Attributes structure for timer.
+ */
+typedef struct {
+	const char* name;     //!< Name of the timer.
+	uint32_t attr_bits;   //!< Attribute bits.
+	void*    cb_mem;      //!< Memory for control block.
+	uint32_t cb_size;     //!< Size of provided memory for control block.
+} osTimerAttr_t;
+
+/* ----------------- Kernel ----------------- */
+
+osStatus_t osKernelInitialize(void);
+osStatus_t osKernelStart(void);
+osKernelState_t osKernelGetState(void);
+uint32_t osKernelGetTickCount(void);
+uint32_t osKernelGetTickFreq(void);
+
+/* ----------------- Threads ----------------- */
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void* argument, const osThreadAttr_t* attr);
+osThreadId_t osThreadGetId(void);
+const char* osThreadGetName(osThreadId_t thread_id);
+uint32_t osThreadGetStackSpace(osThreadId_t thread_id);
+osStatus_t osThreadYield(void);
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags);
+uint32_t osThreadFlagsClear(uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+osStatus_t osDelay(uint32_t ticks);
+osStatus_t osDelayUntil(uint32_t ticks);
+
+/* ----------------- Timers ----------------- */
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void* argument, const osTimerAttr_t* attr);
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks);
+osStatus_t osTimerStop(osTimerId_t timer_id);
+uint32_t osTimerIsRunning(osTimerId_t timer_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _CMSIS_OS2_H_
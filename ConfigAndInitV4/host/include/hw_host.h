@@ -0,0 +1,103 @@
+#ifndef _HW_HOST_H_
+#define _HW_HOST_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Registers of the simulated register file.
+ */
+typedef enum {
+	HW_TIM1_CNT,     //!< Encoder counter, set by the motor model.
+	HW_TIM3_ARR,     //!< PWM auto-reload, 2047 after reset (CubeMX setting).
+	HW_TIM3_CCR1,    //!< PWM compare, counter-clockwise channel.
+	HW_TIM3_CCR2,    //!< PWM compare, clockwise channel.
+	HW_GPIOA_BSRR,   //!< Write-only, reads as 0. Writes update HW_GPIOA_ODR.
+	HW_GPIOA_ODR,    //!< Output data register of GPIOA.
+	HW_REG_COUNT
+} hw_reg_t;
+
+/**
+ * @brief One recorded register access.
+ */
+typedef struct {
+	uint64_t time_ns;   //!< Timestamp from the clock set with HwHost_SetClock().
+	uint32_t value;     //!< Value read or written.
+	uint8_t  reg;       //!< The register (hw_reg_t).
+	uint8_t  write;     //!< 1 for a write, 0 for a read.
+} hw_access_t;
+
+#define HW_HOST_LOG_LEN 65536   //!< Accesses kept in the log, later ones are only counted.
+
+/**
+ * @brief Read a register as the firmware does, recorded.
+ */
+uint32_t HwHost_Read(hw_reg_t reg);
+
+/**
+ * @brief Write a register as the firmware does, recorded.
+ */
+void HwHost_Write(hw_reg_t reg, uint32_t value);
+
+/**
+ * @brief Read a register from the model side, not recorded.
+ */
+uint32_t HwHost_Peek(hw_reg_t reg);
+
+/**
+ * @brief Write a register from the model side (e.g. the encoder count), not recorded.
+ */
+void HwHost_Poke(hw_reg_t reg, uint32_t value);
+
+/**
+ * @brief Restore the reset values, clear the log and the access counters.
+ *
+ * The clock set with HwHost_SetClock() is kept.
+ */
+void HwHost_Reset(void);
+
+/**
+ * @brief Clear the log and the access counters, keep the register values.
+ *
+ * Call it before a control step to count the accesses of that step.
+ */
+void HwHost_ClearLog(void);
+
+/**
+ * @brief Set the time source of the timestamps.
+ *
+ * @param now_ns Function returning the current time in ns, NULL for CLOCK_MONOTONIC.
+ */
+void HwHost_SetClock(uint64_t (*now_ns)(void));
+
+/**
+ * @brief Number of firmware reads of a register since the last clear.
+ */
+uint32_t HwHost_ReadCount(hw_reg_t reg);
+
+/**
+ * @brief Number of firmware writes to a register since the last clear.
+ */
+uint32_t HwHost_WriteCount(hw_reg_t reg);
+
+/**
+ * @brief Access the log of firmware accesses since the last clear.
+ *
+ * @param entries Pointer to where the address of the first entry is written.
+ * @return Number of entries, at most HW_HOST_LOG_LEN.
+ */
+size_t HwHost_Log(const hw_access_t** entries);
+
+/**
+ * @brief Name of a register for printing, e.g. "TIM3_CCR1".
+ */
+const char* HwHost_RegName(hw_reg_t reg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _HW_HOST_H_
@@ -0,0 +1,27 @@
+#ifndef _MAIN_H_
+#define _MAIN_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host stand-in for the CubeMX main.h: the tick accessor and the compiler
+ * attributes the firmware sources use.
+ */
+
+#include <stdint.h>
+
+#ifndef __NO_RETURN
+#define __NO_RETURN __attribute__((__noreturn__))
+#endif
+
+/**
+ * @brief Get the current tick count in milliseconds (the virtual kernel tick on the host).
+ */
+uint32_t Main_GetTickMillisec(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _MAIN_H_
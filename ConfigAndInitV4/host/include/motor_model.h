@@ -0,0 +1,61 @@
+#ifndef _MOTOR_MODEL_H_
+#define _MOTOR_MODEL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Parameters of the simulated DC motor.
+ *
+ * First-order speed response to the PWM duty with Coulomb friction and
+ * stiction, all expressed as speeds (RPM) at the motor's DC gain.
+ */
+typedef struct {
+	double gain_rpm;   //!< Steady-state speed at 100% duty without friction (RPM).
+	double tau_s;      //!< Mechanical time constant (s).
+	double fric_rpm;   //!< Coulomb friction as a speed drop (RPM); breakaway takes 1.5 times this.
+	double load_rpm;   //!< Constant load as a speed drop (RPM), opposing the motion.
+} motor_params_t;
+
+#define MOTOR_PARAMS_DEFAULT { .gain_rpm = 8700.0, .tau_s = 0.08, .fric_rpm = 150.0, .load_rpm = 0.0 }   //!< Close to the lab motor.
+
+/**
+ * @brief Reset the motor to standstill at encoder count 0.
+ *
+ * @param params Pointer to the parameters, copied.
+ */
+void Motor_Init(const motor_params_t* params);
+
+/**
+ * @brief Advance the motor by one time step.
+ *
+ * Reads the duty from TIM3_CCR1/CCR2/ARR and the half-bridge enables from
+ * GPIOA_ODR in the host register file, and writes the new encoder count to
+ * TIM1_CNT (2048 counts per revolution). The register file is accessed from
+ * the model side, so nothing is recorded.
+ *
+ * @param dt_s Time step (s), 1 ms or less for accuracy.
+ */
+void Motor_Step(double dt_s);
+
+/**
+ * @brief Read the true motor speed.
+ *
+ * @return Speed in RPM, positive clockwise.
+ */
+double Motor_GetVelocity(void);
+
+/**
+ * @brief Change the load during a run.
+ *
+ * @param load_rpm Constant load as a speed drop (RPM).
+ */
+void Motor_SetLoad(double load_rpm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _MOTOR_MODEL_H_
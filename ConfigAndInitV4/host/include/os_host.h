@@ -0,0 +1,72 @@
+#ifndef _OS_HOST_H_
+#define _OS_HOST_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Control of the virtual-time CMSIS-RTOS2 emulation (cmsis_os2_host.c).
+ *
+ * Scheduling follows RTX: the highest-priority ready thread runs, equal
+ * priorities in the order they became ready, and a thread that makes a
+ * higher-priority thread ready (osThreadFlagsSet) is preempted at once.
+ * Threads run in zero virtual time; the tick only advances when every
+ * thread is blocked. Each tick first calls the tick hook (the plant model),
+ * then fires the due timers in creation order, then wakes delayed threads.
+ * Timer callbacks run ahead of all threads, as from an RTX timer thread of
+ * the highest priority. The same inputs give the same interleaving on every
+ * run.
+ */
+
+#define OS_HOST_TICK_FREQ  1000         //!< Kernel tick frequency (Hz), as OS_TICK_FREQ in RTX_Config.h.
+#define OS_HOST_THREADS    8            //!< Maximum number of threads.
+#define OS_HOST_TIMERS     8            //!< Maximum number of timers.
+#define OS_HOST_STACK_MIN  (64 * 1024)  //!< Host stack per thread, target stack sizes are too small for libc.
+#define OS_HOST_STACK_FILL 0xCC         //!< Fill byte of new stacks, for osThreadGetStackSpace() (RTX fills with 0xCCCCCCCC).
+
+/**
+ * @brief Scheduling counters since osKernelInitialize().
+ */
+typedef struct {
+	uint32_t switches;      //!< Thread switches (the scheduler resumed a thread).
+	uint32_t preemptions;   //!< Switches forced by a higher-priority thread becoming ready.
+	uint32_t timer_fires;   //!< Timer callbacks run.
+	uint32_t idle_ticks;    //!< Ticks without any thread to run.
+} os_host_stats_t;
+
+/**
+ * @brief Set the virtual time at which osKernelStart() returns.
+ *
+ * @param ticks Absolute tick count, 0 runs until OsHost_Stop().
+ */
+void OsHost_SetHorizon(uint32_t ticks);
+
+/**
+ * @brief Make osKernelStart() return once the running thread blocks.
+ */
+void OsHost_Stop(void);
+
+/**
+ * @brief Set the function called at the start of every tick.
+ *
+ * @param hook Function taking the new tick count, NULL for none.
+ */
+void OsHost_SetTickHook(void (*hook)(uint32_t tick));
+
+/**
+ * @brief Virtual time in nanoseconds, for HwHost_SetClock().
+ */
+uint64_t OsHost_TimeNs(void);
+
+/**
+ * @brief Read the scheduling counters.
+ */
+void OsHost_GetStats(os_host_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _OS_HOST_H_
@@ -0,0 +1,11 @@
+#ifndef _STM32L4XX_H_
+#define _STM32L4XX_H_
+
+/*
+ * Host stand-in for the device header. Registers are reached through hw.h,
+ * so only the core intrinsics used outside of it are provided.
+ */
+
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)   //!< Data memory barrier.
+
+#endif   // _STM32L4XX_H_
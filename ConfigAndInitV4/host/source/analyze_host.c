@@ -0,0 +1,333 @@
+/**
+ * Control KPIs of long telemetry logs (telemetry.h) on Linux.
+ *
+ * @file analyze_host.c
+ *
+ * The log is memory-mapped and read in a single pass, split into one range
+ * of records per thread; only per-thread sums are kept, so files larger
+ * than RAM work and the result does not depend on the number of threads.
+ * A move of the reference (its rate leaving zero, the reversals of the
+ * application) that starts near the end of a range is finished by the
+ * thread it started in, reading on into the next range. KPIs, all
+ * lower-is-better:
+ *   rms_err_rpm, max_err_rpm  reference - measured velocity
+ *   sat_pct                   samples with the applied control at full scale
+ *   settle_ms, settle_max_ms  mean and worst time after the start of a
+ *                             move until |error| stays within SETTLE_BAND_RPM
+ *   jitter_rms_ms, jitter_max_ms
+ *                             deviation of the sample interval from the
+ *                             control period, in whole ticks as logged
+ * Usage:
+ *   analyze_host LOG [--threads N] [--json FILE]
+ * The report has the layout of bench_host's, with the log as the scenario
+ * "telemetry", so two captures compare with bench_host --compare. Counts and
+ * throughput go to stderr.
+ *
+ * Build from ConfigAndInitV4, e.g.
+ *   gcc -O2 -pthread -DHW_HOST -Ihost/include -Iinclude -o analyze_host host/source/analyze_host.c -lm
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include "fixedpoint.h"
+#include "telemetry.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ----------------- Config ----------------- */
+
+#define MAX_THREADS      64
+#define SETTLE_BAND_RPM  40     // 2% of 2000 RPM, as bench_host
+
+/* ----------------- Log ----------------- */
+
+typedef struct {
+	const telemetry_header_t* header;
+	const telemetry_record_t* rec;    // First record in the file
+	size_t                    n;      // Records in time order
+	size_t                    first;  // Index of the oldest record (wrapped ring image)
+	size_t                    cap;    // Records in the file
+} log_view_t;
+
+// Record i in time order.
+static inline const telemetry_record_t* at(const log_view_t* l, size_t i)
+{
+	const size_t k = l->first + i;
+	return &l->rec[(k < l->cap) ? k : k - l->cap];
+}
+
+/* ----------------- Pass ----------------- */
+
+typedef struct {
+	const log_view_t* log;
+	size_t   a, b;           // Range [a, b) of this thread
+
+	uint64_t err_sq;         // RPM^2, integer so the sum does not depend on the split
+	uint32_t max_err;
+	uint64_t saturated;
+	uint64_t intervals;      // Sample intervals without a gap
+	uint64_t jitter_sq;      // ms^2
+	uint32_t jitter_max;
+	uint64_t gaps, lost;
+	uint64_t moves, unsettled;
+	uint64_t settle_sum;     // ms
+	uint32_t settle_max;
+} part_t;
+
+static inline uint32_t uabs32(int64_t x)
+{
+	return (uint32_t)((x < 0) ? -x : x);
+}
+
+// Close the move that started at record 'start', last out of band at 'oob', ending before record 'end'.
+static void settle_done(part_t* p, size_t start, size_t oob, size_t end)
+{
+	const uint32_t ms = at(p->log, oob)->millisec - at(p->log, start)->millisec;
+
+	p->moves++;
+	p->settle_sum += ms;
+	if (ms > p->settle_max)
+		p->settle_max = ms;
+	if (oob + 1U == end)
+		p->unsettled++; // Still out of band when the next move began or the log ended
+}
+
+static void* pass(void* arg)
+{
+	part_t* p = arg;
+	const log_view_t* l = p->log;
+	const uint32_t period = l->header->period_ms;
+
+	int    open = 0;        // A move started in this range is being timed
+	size_t start = 0, oob = 0;
+
+	for (size_t i = p->a; i < l->n; i++)
+	{
+		const telemetry_record_t* r = at(l, i);
+		const telemetry_record_t* prev = (i > 0) ? at(l, i - 1U) : NULL;
+		const int move = (prev != NULL && prev->ref_rate == 0 && r->ref_rate != 0);
+
+		if (i >= p->b)
+		{
+			// Past the range: only finish the open move
+			if (!open)
+				break;
+			if (move)
+			{
+				settle_done(p, start, oob, i);
+				open = 0;
+				break;
+			}
+		}
+		else
+		{
+			const uint32_t err = uabs32((int64_t)r->reference - r->velocity);
+			p->err_sq += (uint64_t)err * err;
+			if (err > p->max_err)
+				p->max_err = err;
+			p->saturated += (r->control == CTRL_MAX || r->control == CTRL_MIN);
+
+			if (prev != NULL)
+			{
+				if (r->seq - prev->seq != 1U)
+				{
+					p->gaps++;
+					p->lost += r->seq - prev->seq - 1U;
+				}
+				else
+				{
+					const uint32_t dev = uabs32((int64_t)(uint32_t)(r->millisec - prev->millisec) - period);
+					p->intervals++;
+					p->jitter_sq += (uint64_t)dev * dev;
+					if (dev > p->jitter_max)
+						p->jitter_max = dev;
+				}
+			}
+
+			if (move)
+			{
+				if (open)
+					settle_done(p, start, oob, i);
+				open  = 1;
+				start = oob = i;
+			}
+		}
+
+		if (open && uabs32((int64_t)r->reference - r->velocity) > SETTLE_BAND_RPM)
+			oob = i;
+	}
+
+	if (open)
+		settle_done(p, start, oob, l->n);
+	return NULL;
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	const char* path = NULL;
+	const char* json = NULL;
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = atol(argv[++i]);
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			json = argv[++i];
+		else
+			path = argv[i];
+	}
+	if (path == NULL)
+	{
+		fprintf(stderr, "usage: analyze_host LOG [--threads N] [--json FILE]\n");
+		return 2;
+	}
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	const int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0)
+	{
+		perror(path);
+		return 2;
+	}
+	if ((size_t)st.st_size < sizeof (telemetry_header_t))
+	{
+		fprintf(stderr, "%s: not a telemetry log\n", path);
+		return 2;
+	}
+
+	void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror("mmap");
+		return 2;
+	}
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+	const telemetry_header_t* h = map;
+	if (h->magic != TELEMETRY_MAGIC || h->version != TELEMETRY_VERSION || h->record_size != sizeof (telemetry_record_t))
+	{
+		fprintf(stderr, "%s: not a telemetry log of format version %u\n", path, TELEMETRY_VERSION);
+		return 2;
+	}
+
+	log_view_t l = { .header = h, .rec = (const telemetry_record_t*)(h + 1) };
+	l.cap = ((size_t)st.st_size - sizeof *h) / sizeof (telemetry_record_t);
+	if (h->capacity > 0U)
+	{
+		// Ring image: the newest min(count, capacity) records, the oldest at count % capacity
+		if (l.cap < h->capacity)
+		{
+			fprintf(stderr, "%s: ring image shorter than its %u records\n", path, h->capacity);
+			return 2;
+		}
+		l.cap   = h->capacity;
+		l.n     = (h->count < h->capacity) ? h->count : h->capacity;
+		l.first = (h->count > h->capacity) ? h->count % h->capacity : 0U;
+	}
+	else
+	{
+		// Stream log: everything in the file, also when the writer stopped before updating 'count'
+		l.n = l.cap;
+		if (h->count != l.n)
+			fprintf(stderr, "%s: header counts %u records, file holds %zu\n", path, h->count, l.n);
+	}
+	if (l.n == 0U)
+	{
+		fprintf(stderr, "%s: no records\n", path);
+		return 2;
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	static part_t part[MAX_THREADS];
+	pthread_t tid[MAX_THREADS];
+	for (long t = 0; t < threads; t++)
+	{
+		part[t].log = &l;
+		part[t].a   = l.n * (size_t)t / (size_t)threads;
+		part[t].b   = l.n * (size_t)(t + 1) / (size_t)threads;
+		if (pthread_create(&tid[t], NULL, pass, &part[t]) != 0)
+		{
+			perror("pthread_create");
+			return 2;
+		}
+	}
+
+	part_t sum = { 0 };
+	for (long t = 0; t < threads; t++)
+	{
+		const part_t* p = &part[t];
+		pthread_join(tid[t], NULL);
+
+		sum.err_sq     += p->err_sq;
+		sum.saturated  += p->saturated;
+		sum.intervals  += p->intervals;
+		sum.jitter_sq  += p->jitter_sq;
+		sum.gaps       += p->gaps;
+		sum.lost       += p->lost;
+		sum.moves      += p->moves;
+		sum.unsettled  += p->unsettled;
+		sum.settle_sum += p->settle_sum;
+		if (p->max_err > sum.max_err)
+			sum.max_err = p->max_err;
+		if (p->jitter_max > sum.jitter_max)
+			sum.jitter_max = p->jitter_max;
+		if (p->settle_max > sum.settle_max)
+			sum.settle_max = p->settle_max;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	const double wall = (double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+	fprintf(stderr, "%zu records (%.1f MB) in %.3f s on %ld threads, %.0f M records/s, %.2f GB/s\n",
+	        l.n, l.n * sizeof (telemetry_record_t) / 1e6, wall, threads,
+	        (wall > 0.0) ? l.n / wall * 1e-6 : 0.0, (wall > 0.0) ? l.n * sizeof (telemetry_record_t) / wall * 1e-9 : 0.0);
+	fprintf(stderr, "%llu moves (%llu not settled before the next), %llu gaps (%llu records lost)\n",
+	        (unsigned long long)sum.moves, (unsigned long long)sum.unsettled,
+	        (unsigned long long)sum.gaps, (unsigned long long)sum.lost);
+
+	FILE* out = stdout;
+	if (json != NULL)
+	{
+		out = fopen(json, "w");
+		if (out == NULL)
+		{
+			perror(json);
+			return 2;
+		}
+	}
+
+	fprintf(out, "{\n  \"build\": \"CONTROLLER_LAW=%u\",\n  \"scenarios\": [\n", h->law);
+	fprintf(out, "    {\n      \"name\": \"telemetry\"");
+	fprintf(out, ",\n      \"rms_err_rpm\": %.3f", sqrt((double)sum.err_sq / (double)l.n));
+	fprintf(out, ",\n      \"max_err_rpm\": %.3f", (double)sum.max_err);
+	fprintf(out, ",\n      \"sat_pct\": %.3f", 100.0 * (double)sum.saturated / (double)l.n);
+	fprintf(out, ",\n      \"settle_ms\": %.3f", (sum.moves > 0U) ? (double)sum.settle_sum / (double)sum.moves : 0.0);
+	fprintf(out, ",\n      \"settle_max_ms\": %.3f", (double)sum.settle_max);
+	fprintf(out, ",\n      \"jitter_rms_ms\": %.3f", (sum.intervals > 0U) ? sqrt((double)sum.jitter_sq / (double)sum.intervals) : 0.0);
+	fprintf(out, ",\n      \"jitter_max_ms\": %.3f", (double)sum.jitter_max);
+	fprintf(out, "\n    }\n  ]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	munmap(map, (size_t)st.st_size);
+	return 0;
+}
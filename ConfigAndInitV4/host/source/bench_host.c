@@ -0,0 +1,465 @@
+/**
+ * Closed-loop benchmark of the control step on Linux, with KPI reports.
+ *
+ * @file bench_host.c
+ *
+ * Runs the firmware estimator, controller and PWM output (the same pipeline
+ * as application.c) every PERIOD_CTRL ms against the motor model, over a
+ * fixed set of scenarios. Each scenario runs in its own forked process, so
+ * it starts from the firmware's power-on state whatever ran before it.
+ * Scenarios are deterministic, so every run gives the same control KPIs;
+ * each scenario is run CPU_REPEATS times and the CPU KPIs are the lowest of
+ * the runs, which filters out interference from the rest of the machine.
+ * Usage:
+ *   bench_host [--json FILE]               Run all scenarios, JSON to stdout or FILE
+ *   bench_host --compare BASE NEW [TOL [CPU_TOL]]
+ *                                          Report KPI changes, exit 1 on a regression
+ *                                          or a scenario or KPI missing from NEW
+ * TOL and CPU_TOL are the allowed relative increases in percent of the
+ * control and the CPU KPIs (default 5 and 25; host step times of the same
+ * build spread by up to 20% between runs on a busy or virtual machine).
+ *
+ * Build from ConfigAndInitV4, e.g.
+ *   gcc -O2 -DHW_HOST -Ihost/include -Iinclude -o bench_host \
+ *       host/source/bench_host.c host/source/hw_host.c host/source/motor_model.c \
+ *       source/controller.c source/peripherals.c source/trajectory.c -lm
+ * and add e.g. -DCONTROLLER_LAW=1 to benchmark another law.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "application.h"
+#include "controller.h"
+#include "peripherals.h"
+#include "pipeline.h"
+#include "trajectory.h"
+#include "hw_host.h"
+#include "motor_model.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ----------------- Config ----------------- */
+
+#define MAX_STEPS        4096   // Control steps per scenario (41 s)
+#define MAX_EVENTS       8      // Reference changes or disturbances per scenario
+#define MAX_SCENARIOS    8
+#define MAX_KPIS         16
+#define SETTLE_BAND_RPM  40     // 2% of 2000 RPM
+#define LOAD_STEP_RPM    800.0  // Load of the load-step scenario, as a speed drop
+#define NOISE_COUNTS     2      // Encoder noise amplitude of the noise scenario (+/- counts)
+#define RAMP_END_RPM     3000   // End speed of the ramp scenario
+#define RAMP_RATE_RPM_S  300    // Slope of the ramp scenario
+#define CPU_REPEATS      7      // Runs per scenario, CPU KPIs are the best of them
+
+/* ----------------- Scenarios ----------------- */
+
+typedef enum { SC_REVERSAL, SC_LOAD_STEP, SC_RAMP, SC_NOISE, SC_COUNT } scenario_t;
+
+static const char* const scenario_names[SC_COUNT] = {
+	[SC_REVERSAL]  = "reversal",
+	[SC_LOAD_STEP] = "load_step",
+	[SC_RAMP]      = "ramp",
+	[SC_NOISE]     = "noise",
+};
+
+static const uint32_t scenario_ms[SC_COUNT] = {
+	[SC_REVERSAL]  = 16000,
+	[SC_LOAD_STEP] = 8000,
+	[SC_RAMP]      = 20000,
+	[SC_NOISE]     = 16000,
+};
+
+/**
+ * KPIs of one scenario, all lower-is-better.
+ */
+typedef enum {
+	KPI_RMS_ERR,          // RMS of reference - motor speed (RPM)
+	KPI_MAX_ERR,          // Largest |error| (RPM)
+	KPI_IAE,              // Integral of |error| (RPM s)
+	KPI_OVERSHOOT,        // Largest excursion beyond a settled reference (RPM)
+	KPI_SETTLE,           // Mean time after an event until |error| stays within SETTLE_BAND_RPM (ms)
+	KPI_CTRL_RMS,         // RMS duty, control effort (%)
+	KPI_NS_STEP_MEAN,     // Host time of one control step (ns), CPU KPIs from here on
+	KPI_NS_STEP_MEDIAN,
+	KPI_WRITES_PER_STEP,  // Register writes of one control step
+	KPI_COUNT
+} kpi_id_t;
+
+static const char* const kpi_names[KPI_COUNT] = {
+	[KPI_RMS_ERR]         = "rms_err_rpm",
+	[KPI_MAX_ERR]         = "max_err_rpm",
+	[KPI_IAE]             = "iae_rpm_s",
+	[KPI_OVERSHOOT]       = "overshoot_rpm",
+	[KPI_SETTLE]          = "settle_ms",
+	[KPI_CTRL_RMS]        = "ctrl_rms_pct",
+	[KPI_NS_STEP_MEAN]    = "ns_step_mean",
+	[KPI_NS_STEP_MEDIAN]  = "ns_step_median",
+	[KPI_WRITES_PER_STEP] = "writes_per_step",
+};
+
+typedef struct {
+	double v[KPI_COUNT];
+} kpi_t;
+
+// The loop of application.c, without ILC or excitation stages.
+PIPELINE_DEFINE(bench_pipeline, Peripheral_Encoder_CalculateVelocity, Pipeline_Controller, Pipeline_NoLimit, Peripheral_PWM_ActuateMotor)
+
+/* ----------------- Helpers ----------------- */
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Smallest time between two clock reads, subtracted from every step time.
+static uint64_t timer_overhead_ns(void)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int i = 0; i < 1000; i++)
+	{
+		const uint64_t t0 = now_ns();
+		const uint64_t t1 = now_ns();
+		if (t1 - t0 < best)
+			best = t1 - t0;
+	}
+	return best;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+	const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+// Deterministic noise in [-amp, amp], the same sequence on every run.
+static int32_t noise(int32_t amp)
+{
+	static uint32_t lcg = 12345U;
+	lcg = lcg * 1664525U + 1013904223U;
+	return (int32_t)((lcg >> 16) % (uint32_t)(2 * amp + 1)) - amp;
+}
+
+/* ----------------- Run ----------------- */
+
+static kpi_t run_scenario(scenario_t sc)
+{
+	static uint32_t ns_step[MAX_STEPS];
+	const uint64_t overhead = timer_overhead_ns();
+	uint32_t events[MAX_EVENTS];
+	uint32_t n_events = 0;
+	int32_t  target = (sc == SC_RAMP) ? RAMP_END_RPM : REF_AMPLITUDE_RPM;  // Overshoot is measured against it
+
+	const motor_params_t motor = MOTOR_PARAMS_DEFAULT;
+	HwHost_Reset();
+	Motor_Init(&motor);
+	Peripheral_GPIO_EnableMotor();
+	Controller_Reset();
+
+	if (sc == SC_RAMP)
+		Trajectory_Ramp(target, RAMP_RATE_RPM_S);
+	else
+		Trajectory_SCurve(target, REF_ACCEL_RPM_S);
+	events[n_events++] = 0;
+
+	double err_sq = 0.0, iae = 0.0, max_err = 0.0, overshoot = 0.0, ctrl_sq = 0.0;
+	uint32_t writes = 0, steps = 0;
+	uint32_t last_out_of_band[MAX_EVENTS] = { 0 };
+
+	for (uint32_t ms = PERIOD_CTRL; ms <= scenario_ms[sc] && steps < MAX_STEPS; ms += PERIOD_CTRL)
+	{
+		for (int i = 0; i < PERIOD_CTRL; i++)
+			Motor_Step(0.001);
+
+		// Disturbances and reference changes at the start of the sample
+		if ((sc == SC_REVERSAL || sc == SC_NOISE) && ms % PERIOD_REF == 0U && ms < scenario_ms[sc] && n_events < MAX_EVENTS)
+		{
+			target = -target;
+			Trajectory_SCurve(target, REF_ACCEL_RPM_S);
+			events[n_events++] = ms;
+		}
+		if (sc == SC_LOAD_STEP && ms == scenario_ms[sc] / 2U)
+		{
+			Motor_SetLoad(LOAD_STEP_RPM);
+			events[n_events++] = ms;
+		}
+		if (sc == SC_NOISE)
+			HwHost_Poke(HW_TIM1_CNT, (HwHost_Peek(HW_TIM1_CNT) + (uint32_t)noise(NOISE_COUNTS)) & 0xFFFFU);
+
+		ctrl_state_t s = { .millisec = ms };
+		int32_t ref_rate;
+		Trajectory_Step(&s.reference, &ref_rate);
+		Controller_SetReferenceRate(ref_rate);
+
+		HwHost_ClearLog();
+		const uint64_t t0 = now_ns();
+		bench_pipeline_step(&s);
+		const uint64_t t1 = now_ns();
+		for (int r = 0; r < HW_REG_COUNT; r++)
+			writes += HwHost_WriteCount((hw_reg_t)r);
+
+		// Tracking KPIs on the true motor speed, so encoder noise counts as an error of the loop only
+		const double err  = (double)s.reference - Motor_GetVelocity();
+		const double duty = 100.0 * (double)s.control / (double)(1 << 30);
+
+		ns_step[steps++] = (t1 - t0 > overhead) ? (uint32_t)(t1 - t0 - overhead) : 0U;
+		err_sq  += err * err;
+		iae     += fabs(err) * PERIOD_CTRL / 1000.0;
+		ctrl_sq += duty * duty;
+		if (fabs(err) > max_err)
+			max_err = fabs(err);
+		if (s.reference == target && ref_rate == 0)
+		{
+			const double beyond = ((target > 0) ? 1.0 : -1.0) * Motor_GetVelocity() - fabs((double)target);
+			if (beyond > overshoot)
+				overshoot = beyond;
+		}
+		if (fabs(err) > SETTLE_BAND_RPM)
+			last_out_of_band[n_events - 1] = ms;
+	}
+
+	kpi_t k = { 0 };
+	double settle = 0.0;
+	for (uint32_t e = 0; e < n_events; e++)
+		settle += (last_out_of_band[e] > events[e]) ? (double)(last_out_of_band[e] - events[e]) : 0.0;
+
+	qsort(ns_step, steps, sizeof(ns_step[0]), cmp_u32);
+	double ns_sum = 0.0;
+	for (uint32_t i = 0; i < steps; i++)
+		ns_sum += ns_step[i];
+
+	k.v[KPI_RMS_ERR]         = sqrt(err_sq / steps);
+	k.v[KPI_MAX_ERR]         = max_err;
+	k.v[KPI_IAE]             = iae;
+	k.v[KPI_OVERSHOOT]       = overshoot;
+	k.v[KPI_SETTLE]          = settle / n_events;
+	k.v[KPI_CTRL_RMS]        = sqrt(ctrl_sq / steps);
+	k.v[KPI_NS_STEP_MEAN]    = ns_sum / steps;
+	k.v[KPI_NS_STEP_MEDIAN]  = ns_step[steps / 2U];
+	k.v[KPI_WRITES_PER_STEP] = (double)writes / steps;
+	return k;
+}
+
+// Run one scenario in a child process, so every scenario starts from reset state.
+static int run_isolated(scenario_t sc, kpi_t* k)
+{
+	int fd[2];
+	if (pipe(fd) != 0)
+		return -1;
+
+	const pid_t pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+	{
+		const kpi_t r = run_scenario(sc);
+		close(fd[0]);
+		_exit(write(fd[1], &r, sizeof(r)) == (ssize_t)sizeof(r) ? 0 : 1);
+	}
+
+	close(fd[1]);
+	const ssize_t n = read(fd[0], k, sizeof(*k));
+	close(fd[0]);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return (n == (ssize_t)sizeof(*k) && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static int run_all(FILE* out)
+{
+	fprintf(out, "{\n  \"build\": \"CONTROLLER_LAW=%d\",\n  \"scenarios\": [\n", CONTROLLER_LAW);
+
+	for (int sc = 0; sc < SC_COUNT; sc++)
+	{
+		kpi_t k;
+		for (int rep = 0; rep < CPU_REPEATS; rep++)
+		{
+			kpi_t r;
+			if (run_isolated((scenario_t)sc, &r) != 0)
+			{
+				fprintf(stderr, "scenario %s failed\n", scenario_names[sc]);
+				return 1;
+			}
+			if (rep == 0)
+				k = r;
+			for (int i = KPI_NS_STEP_MEAN; i < KPI_COUNT; i++)
+			{
+				if (r.v[i] < k.v[i])
+					k.v[i] = r.v[i];
+			}
+		}
+
+		fprintf(out, "    {\n      \"name\": \"%s\"", scenario_names[sc]);
+		for (int i = 0; i < KPI_COUNT; i++)
+			fprintf(out, ",\n      \"%s\": %.3f", kpi_names[i], k.v[i]);
+		fprintf(out, "\n    }%s\n", (sc + 1 < SC_COUNT) ? "," : "");
+	}
+
+	fprintf(out, "  ]\n}\n");
+	return 0;
+}
+
+/* ----------------- Compare ----------------- */
+
+typedef struct {
+	char   name[32];
+	char   kpi[MAX_KPIS][32];
+	double value[MAX_KPIS];
+	int    n;
+} report_scenario_t;
+
+// Read a report written by run_all(): one "key": value pair per line.
+static int load_report(const char* path, report_scenario_t* sc, int* n_sc)
+{
+	FILE* f = fopen(path, "r");
+	if (f == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+
+	char line[256], key[32], str[32];
+	double value;
+	*n_sc = 0;
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		if (sscanf(line, " \"name\": \"%31[^\"]\"", str) == 1 && *n_sc < MAX_SCENARIOS)
+		{
+			report_scenario_t* s = &sc[(*n_sc)++];
+			memset(s, 0, sizeof(*s));
+			strcpy(s->name, str);
+		}
+		else if (sscanf(line, " \"%31[^\"]\": %lf", key, &value) == 2 && *n_sc > 0)
+		{
+			report_scenario_t* s = &sc[*n_sc - 1];
+			if (s->n < MAX_KPIS)
+			{
+				strcpy(s->kpi[s->n], key);
+				s->value[s->n++] = value;
+			}
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+// Scenario of that name, NULL if the report has none.
+static const report_scenario_t* find_scenario(const report_scenario_t* sc, int n, const char* name)
+{
+	for (int i = 0; i < n; i++)
+	{
+		if (strcmp(sc[i].name, name) == 0)
+			return &sc[i];
+	}
+	return NULL;
+}
+
+// Index of the KPI of that name in a scenario, -1 if it has none.
+static int find_kpi(const report_scenario_t* s, const char* kpi)
+{
+	for (int k = 0; k < s->n; k++)
+	{
+		if (strcmp(s->kpi[k], kpi) == 0)
+			return k;
+	}
+	return -1;
+}
+
+// Pairs scenarios and KPIs by name. What the base has and the new report lacks counts as a failure.
+static int compare(const char* base_path, const char* new_path, double tol_pct, double cpu_tol_pct)
+{
+	static report_scenario_t base[MAX_SCENARIOS], cur[MAX_SCENARIOS];
+	int n_base, n_cur, regressions = 0, missing = 0;
+
+	if (load_report(base_path, base, &n_base) != 0 || load_report(new_path, cur, &n_cur) != 0)
+		return 2;
+
+	printf("%-10s %-16s %12s %12s %9s\n", "scenario", "kpi", "base", "new", "change");
+	for (int i = 0; i < n_base; i++)
+	{
+		if (find_scenario(cur, n_cur, base[i].name) == NULL)
+		{
+			printf("%-10s (not in new)\n", base[i].name);
+			missing++;
+		}
+	}
+
+	for (int i = 0; i < n_cur; i++)
+	{
+		const report_scenario_t* b = find_scenario(base, n_base, cur[i].name);
+		if (b == NULL)
+		{
+			printf("%-10s (not in base)\n", cur[i].name);
+			continue;
+		}
+
+		for (int k = 0; k < b->n; k++)
+		{
+			if (find_kpi(&cur[i], b->kpi[k]) < 0)
+			{
+				printf("%-10s %-16s (not in new)\n", cur[i].name, b->kpi[k]);
+				missing++;
+			}
+		}
+
+		for (int k = 0; k < cur[i].n; k++)
+		{
+			const int kb = find_kpi(b, cur[i].kpi[k]);
+			if (kb < 0)
+			{
+				printf("%-10s %-16s (not in base)\n", cur[i].name, cur[i].kpi[k]);
+				continue;
+			}
+
+			int cpu = 0;
+			for (int c = KPI_NS_STEP_MEAN; c < KPI_COUNT; c++)
+				cpu |= (strcmp(cur[i].kpi[k], kpi_names[c]) == 0);
+
+			// Relative change, with a small absolute floor so near-zero KPIs don't flag on noise
+			const double old = b->value[kb], now = cur[i].value[k];
+			const double tol = (cpu ? cpu_tol_pct : tol_pct) / 100.0;
+			const double pct = (fabs(old) > 1e-9) ? 100.0 * (now - old) / fabs(old) : 0.0;
+			const int worse  = now > old * (1.0 + tol) + 0.5;
+
+			regressions += worse;
+			printf("%-10s %-16s %12.3f %12.3f %+8.1f%%%s\n", cur[i].name, cur[i].kpi[k], old, now, pct, worse ? "  REGRESSION" : "");
+		}
+	}
+
+	printf("%d regression(s), %d missing from the new report\n", regressions, missing);
+	return (regressions || missing) ? 1 : 0;
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "--compare") == 0)
+		return compare(argv[2], argv[3], (argc >= 5) ? atof(argv[4]) : 5.0, (argc >= 6) ? atof(argv[5]) : 25.0);
+
+	FILE* out = stdout;
+	if (argc >= 3 && strcmp(argv[1], "--json") == 0)
+	{
+		out = fopen(argv[2], "w");
+		if (out == NULL)
+		{
+			perror(argv[2]);
+			return 2;
+		}
+	}
+
+	const int rc = run_all(out);
+	if (out != stdout)
+		fclose(out);
+	return rc;
+}
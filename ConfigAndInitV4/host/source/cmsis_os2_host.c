@@ -0,0 +1,508 @@
+/**
+ * Handles the virtual-time CMSIS-RTOS2 emulation of the host build.
+ *
+ * @file cmsis_os2_host.c
+ *
+ * Every thread is a ucontext coroutine with its own stack. The scheduler
+ * runs in the context of osKernelStart(): it resumes the highest-priority
+ * ready thread until that thread blocks or is preempted, and advances the
+ * virtual tick only when no thread is ready. Nothing depends on the wall
+ * clock, so a run is deterministic and as fast as the code it executes.
+ * See os_host.h for the exact semantics.
+ *
+ * @cite https://arm-software.github.io/CMSIS_6/latest/RTOS2/group__CMSIS__RTOS.html
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "cmsis_os2.h"
+#include "os_host.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+/* ----------------- Types ----------------- */
+
+typedef enum {
+	TH_FREE = 0,   // Slot unused
+	TH_READY,
+	TH_RUNNING,
+	TH_BLOCKED,
+	TH_EXITED
+} th_state_t;
+
+typedef struct {
+	ucontext_t     ctx;
+	void*          stack;
+	size_t         stack_size;
+	osThreadFunc_t func;
+	void*          arg;
+	const char*    name;
+	osPriority_t   prio;
+	th_state_t     state;
+	int64_t        ready_seq;   // FIFO order within a priority
+	uint32_t       flags;
+	uint32_t       wait_flags;  // 0 while in osDelay()
+	uint32_t       wait_opt;
+	uint32_t       wake_tick;
+	uint8_t        timed;       // wake_tick is valid
+	uint32_t       result;      // Return value of the wait
+} os_thread_t;
+
+typedef struct {
+	osTimerFunc_t func;
+	void*         arg;
+	osTimerType_t type;
+	uint8_t       used;
+	uint8_t       running;
+	uint32_t      period;
+	uint32_t      next;
+} os_timer_t;
+
+/* ----------------- State ----------------- */
+
+static os_thread_t threads[OS_HOST_THREADS];
+static os_timer_t  timers[OS_HOST_TIMERS];
+
+static ucontext_t       sched_ctx;
+static os_thread_t*     current = NULL;
+static osKernelState_t  kstate  = osKernelInactive;
+static uint32_t         tick    = 0;
+static uint32_t         horizon = 0;
+static uint8_t          stop    = 0;
+static int64_t          seq_back  = 0;    // Next sequence number at the back of a ready list
+static int64_t          seq_front = -1;   // Next sequence number at the front (preempted threads)
+static void           (*tick_hook)(uint32_t) = NULL;
+static os_host_stats_t  stats;
+
+/* ----------------- Scheduling ----------------- */
+
+static void make_ready(os_thread_t* t)
+{
+	t->state     = TH_READY;
+	t->timed     = 0;
+	t->ready_seq = seq_back++;
+}
+
+static os_thread_t* highest_ready(void)
+{
+	os_thread_t* best = NULL;
+
+	for (int i = 0; i < OS_HOST_THREADS; i++)
+	{
+		os_thread_t* t = &threads[i];
+		if (t->state != TH_READY)
+			continue;
+		if (best == NULL || t->prio > best->prio || (t->prio == best->prio && t->ready_seq < best->ready_seq))
+			best = t;
+	}
+	return best;
+}
+
+// Give the CPU back to the scheduler, the caller has set its own state.
+static void switch_out(void)
+{
+	os_thread_t* self = current;
+
+	current = NULL;
+	swapcontext(&self->ctx, &sched_ctx);
+	current = self;
+	self->state = TH_RUNNING;
+}
+
+// Preempt the running thread if a higher-priority thread is ready.
+static void preempt_check(void)
+{
+	if (current == NULL)
+		return; // Scheduler context (timer callback), dispatch follows anyway
+
+	const os_thread_t* t = highest_ready();
+	if (t != NULL && t->prio > current->prio)
+	{
+		current->state     = TH_READY;
+		current->ready_seq = seq_front--; // A preempted thread resumes first within its priority
+		stats.preemptions++;
+		switch_out();
+	}
+}
+
+static void block(uint32_t timeout)
+{
+	current->state = TH_BLOCKED;
+	current->timed = (timeout != osWaitForever);
+	current->wake_tick = tick + timeout;
+	switch_out();
+}
+
+static uint8_t flags_match(const os_thread_t* t)
+{
+	if (t->wait_opt & osFlagsWaitAll)
+		return (t->flags & t->wait_flags) == t->wait_flags;
+	return (t->flags & t->wait_flags) != 0U;
+}
+
+// Take the flags a satisfied wait returns, clearing them unless osFlagsNoClear.
+static uint32_t flags_take(os_thread_t* t)
+{
+	const uint32_t flags = t->flags;
+
+	if ((t->wait_opt & osFlagsNoClear) == 0U)
+		t->flags &= ~t->wait_flags;
+	return flags;
+}
+
+static void thread_entry(void)
+{
+	current->func(current->arg);
+
+	current->state = TH_EXITED; // Returning from a thread function ends it (osThreadExit)
+	current = NULL;
+	setcontext(&sched_ctx);
+}
+
+static void init_context(os_thread_t* t, size_t stack_size)
+{
+	getcontext(&t->ctx);
+	t->ctx.uc_stack.ss_sp   = t->stack;
+	t->ctx.uc_stack.ss_size = stack_size;
+	t->ctx.uc_link          = NULL;
+	makecontext(&t->ctx, thread_entry, 0);
+}
+
+static void tick_advance(void)
+{
+	tick++;
+
+	if (tick_hook != NULL)
+		tick_hook(tick);
+
+	for (int i = 0; i < OS_HOST_TIMERS; i++)
+	{
+		os_timer_t* tm = &timers[i];
+		if (!tm->used || !tm->running || tm->next != tick)
+			continue;
+
+		if (tm->type == osTimerPeriodic)
+			tm->next += tm->period;
+		else
+			tm->running = 0;
+
+		stats.timer_fires++;
+		tm->func(tm->arg);
+	}
+
+	for (int i = 0; i < OS_HOST_THREADS; i++)
+	{
+		os_thread_t* t = &threads[i];
+		if (t->state == TH_BLOCKED && t->timed && t->wake_tick == tick)
+		{
+			t->result = (t->wait_flags != 0U) ? osFlagsErrorTimeout : (uint32_t)osOK;
+			make_ready(t);
+		}
+	}
+}
+
+/* ----------------- Kernel ----------------- */
+
+osStatus_t osKernelInitialize(void)
+{
+	if (kstate == osKernelRunning)
+		return osError;
+
+	for (int i = 0; i < OS_HOST_THREADS; i++)
+	{
+		free(threads[i].stack);
+		threads[i] = (os_thread_t){ 0 };
+	}
+	for (int i = 0; i < OS_HOST_TIMERS; i++)
+		timers[i] = (os_timer_t){ 0 };
+
+	current   = NULL;
+	tick      = 0;
+	stop      = 0;
+	seq_back  = 0;
+	seq_front = -1;
+	stats     = (os_host_stats_t){ 0 };
+	kstate    = osKernelReady;
+
+	return osOK;
+}
+
+osStatus_t osKernelStart(void)
+{
+	if (kstate != osKernelReady)
+		return osError;
+
+	kstate = osKernelRunning;
+
+	while (!stop)
+	{
+		os_thread_t* t = highest_ready();
+		if (t != NULL)
+		{
+			current = t;
+			t->state = TH_RUNNING;
+			stats.switches++;
+			swapcontext(&sched_ctx, &t->ctx);
+			continue;
+		}
+
+		if (horizon != 0U && tick >= horizon)
+			break;
+
+		stats.idle_ticks++;
+		tick_advance();
+	}
+
+	kstate = osKernelReady; // Returns to the host program, threads keep their state
+	stop   = 0;
+
+	return osOK;
+}
+
+osKernelState_t osKernelGetState(void)
+{
+	return kstate;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+	return tick;
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+	return OS_HOST_TICK_FREQ;
+}
+
+/* ----------------- Threads ----------------- */
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void* argument, const osThreadAttr_t* attr)
+{
+	if (func == NULL)
+		return NULL;
+
+	os_thread_t* t = NULL;
+	for (int i = 0; i < OS_HOST_THREADS && t == NULL; i++)
+	{
+		if (threads[i].state == TH_FREE)
+			t = &threads[i];
+	}
+	if (t == NULL)
+		return NULL;
+
+	size_t stack_size = (attr != NULL) ? attr->stack_size : 0U;
+	if (stack_size < OS_HOST_STACK_MIN)
+		stack_size = OS_HOST_STACK_MIN;
+
+	t->stack = malloc(stack_size);
+	if (t->stack == NULL)
+		return NULL;
+	memset(t->stack, OS_HOST_STACK_FILL, stack_size); // Watermark, as RTX with OS_STACK_WATERMARK
+	t->stack_size = stack_size;
+
+	t->func  = func;
+	t->arg   = argument;
+	t->name  = (attr != NULL) ? attr->name : NULL;
+	t->prio  = (attr != NULL && attr->priority != osPriorityNone) ? attr->priority : osPriorityNormal;
+	t->flags = 0;
+
+	init_context(t, stack_size);
+	make_ready(t);
+	preempt_check();
+
+	return t;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+	return current;
+}
+
+const char* osThreadGetName(osThreadId_t thread_id)
+{
+	return (thread_id != NULL) ? ((const os_thread_t*)thread_id)->name : NULL;
+}
+
+uint32_t osThreadGetStackSpace(osThreadId_t thread_id)
+{
+	const os_thread_t* t = thread_id;
+	if (t == NULL || t->stack == NULL)
+		return 0;
+
+	// The stack grows down, count the untouched fill from the bottom
+	const uint8_t* p = t->stack;
+	size_t free_bytes = 0;
+	while (free_bytes < t->stack_size && p[free_bytes] == OS_HOST_STACK_FILL)
+		free_bytes++;
+	return (uint32_t)free_bytes;
+}
+
+osStatus_t osThreadYield(void)
+{
+	if (current == NULL)
+		return osErrorISR;
+
+	make_ready(current);
+	switch_out();
+
+	return osOK;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+	os_thread_t* t = (os_thread_t*)thread_id;
+
+	if (t == NULL || t->state == TH_FREE || (flags & osFlagsError) != 0U)
+		return osFlagsErrorParameter;
+
+	t->flags |= flags;
+	const uint32_t result = t->flags;
+
+	if (t->state == TH_BLOCKED && t->wait_flags != 0U && flags_match(t))
+	{
+		t->result = flags_take(t);
+		make_ready(t);
+		preempt_check();
+	}
+
+	return result;
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+	if (current == NULL)
+		return osFlagsErrorISR;
+
+	const uint32_t previous = current->flags;
+	current->flags &= ~flags;
+
+	return previous;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+	if (current == NULL)
+		return osFlagsErrorISR;
+	if (flags == 0U || (flags & osFlagsError) != 0U)
+		return osFlagsErrorParameter;
+
+	current->wait_flags = flags;
+	current->wait_opt   = options;
+
+	if (flags_match(current))
+		return flags_take(current);
+	if (timeout == 0U)
+		return osFlagsErrorResource;
+
+	block(timeout);
+
+	return current->result;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+	if (current == NULL)
+		return osErrorISR;
+	if (ticks == 0U)
+		return osOK;
+
+	current->wait_flags = 0;
+	block(ticks);
+
+	return osOK;
+}
+
+osStatus_t osDelayUntil(uint32_t ticks)
+{
+	const uint32_t delay = ticks - tick;
+
+	if (delay == 0U || delay > 0x7FFFFFFFU)
+		return osErrorParameter;
+
+	return osDelay(delay);
+}
+
+/* ----------------- Timers ----------------- */
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void* argument, const osTimerAttr_t* attr)
+{
+	(void)attr; // Timers have no name or control block here
+
+	if (func == NULL)
+		return NULL;
+
+	for (int i = 0; i < OS_HOST_TIMERS; i++)
+	{
+		if (!timers[i].used)
+		{
+			timers[i] = (os_timer_t){ .func = func, .arg = argument, .type = type, .used = 1 };
+			return &timers[i];
+		}
+	}
+	return NULL;
+}
+
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
+{
+	os_timer_t* tm = (os_timer_t*)timer_id;
+
+	if (tm == NULL || !tm->used || ticks == 0U)
+		return osErrorParameter;
+
+	tm->period  = ticks;
+	tm->next    = tick + ticks;
+	tm->running = 1;
+
+	return osOK;
+}
+
+osStatus_t osTimerStop(osTimerId_t timer_id)
+{
+	os_timer_t* tm = (os_timer_t*)timer_id;
+
+	if (tm == NULL || !tm->used)
+		return osErrorParameter;
+	if (!tm->running)
+		return osErrorResource;
+
+	tm->running = 0;
+
+	return osOK;
+}
+
+uint32_t osTimerIsRunning(osTimerId_t timer_id)
+{
+	const os_timer_t* tm = (const os_timer_t*)timer_id;
+
+	return (tm != NULL && tm->used) ? tm->running : 0U;
+}
+
+/* ----------------- Host control ----------------- */
+
+void OsHost_SetHorizon(uint32_t ticks)
+{
+	horizon = ticks;
+}
+
+void OsHost_Stop(void)
+{
+	stop = 1;
+}
+
+void OsHost_SetTickHook(void (*hook)(uint32_t tick))
+{
+	tick_hook = hook;
+}
+
+uint64_t OsHost_TimeNs(void)
+{
+	return (uint64_t)tick * (1000000000ULL / OS_HOST_TICK_FREQ);
+}
+
+void OsHost_GetStats(os_host_stats_t* s)
+{
+	*s = stats;
+}
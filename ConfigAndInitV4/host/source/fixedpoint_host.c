@@ -0,0 +1,275 @@
+/**
+ * Checks the saturating helpers (fixedpoint.h) against plain 64-bit C on Linux.
+ *
+ * @file fixedpoint_host.c
+ *
+ * The control path used to form its sums and saturations in 64 bits; it now
+ * uses the helpers, which map onto SSAT, QADD and SMULL on the target. This
+ * program runs the old 64-bit form and the helpers on the same inputs, half
+ * of them drawn around the range limits, and counts the results that differ:
+ *   sat30_wide, sat15_wide  Fix_Sat30Wide(), Fix_Sat15Wide() vs 64-bit compares
+ *   qadd, qsub              Fix_QAdd(), Fix_QSub() vs the clamped 64-bit sum
+ *   pi_output               the PI output sum of controller.c with QADD, its
+ *                           saturation and anti-windup flags, vs the exact sum
+ *   control_to_counts       Peripheral_PWM_ControlToCounts() vs the 64-bit
+ *                           product with both clips, for every 16-bit ARR
+ * and prints the host time per call of both forms. The times are of this
+ * machine; Cortex-M4 cycles come from microbench (MICROBENCH in
+ * application.h) on the target. Usage:
+ *   fixedpoint_host [cases]
+ * The exit status is 1 if any result differs.
+ *
+ * Build from ConfigAndInitV4 with the target branch of fixedpoint.h (its
+ * intrinsics emulated), e.g.
+ *   gcc -O2 -DHW_HOST -DFIX_ACLE=1 -Ihost/include -Iinclude -o fixedpoint_host \
+ *       host/source/fixedpoint_host.c host/source/hw_host.c source/peripherals.c
+ * and with -DFIX_ACLE=0 to check the portable branch.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "fixedpoint.h"
+#include "peripherals.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ----------------- Inputs ----------------- */
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static volatile int64_t sink; // Keeps timed results alive
+
+// Pseudo-random 64-bit value (xorshift64*), the same sequence every run.
+static uint64_t rnd(void)
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return rng * 0x2545F4914F6CDD1DULL;
+}
+
+// Random int32, every second one near a limit of the Q15, Q30 or int32 range.
+static int32_t rnd_i32(void)
+{
+	static const int32_t edge[] = { 0, 32767, -32768, CTRL_MAX, CTRL_MIN, INT32_MAX, INT32_MIN };
+	const uint64_t r = rnd();
+	if (r & 1U)
+		return (int32_t)(r >> 32);
+	return (int32_t)((uint32_t)edge[(r >> 8) % (sizeof edge / sizeof edge[0])] + (uint32_t)((r >> 16) & 7U) - 4U); // Wraps past the int32 limits
+}
+
+// Random int64, mostly beyond the int32 range, every second one near a limit.
+static int64_t rnd_i64(void)
+{
+	const uint64_t r = rnd();
+	if (r & 1U)
+		return (int64_t)rnd() >> (r >> 58); // Any magnitude
+	return (int64_t)rnd_i32() + (int64_t)(int32_t)((r >> 8) & 0xFFU) - 128;
+}
+
+// Random Q30 value, clamped like the terms of the PI sum.
+static int32_t rnd_q30(void)
+{
+	const int32_t x = rnd_i32();
+	return (x > CTRL_MAX) ? CTRL_MAX : ((x < CTRL_MIN) ? CTRL_MIN : x);
+}
+
+/* ----------------- 64-bit reference ----------------- */
+
+static int32_t ref_sat30_wide(int64_t x)
+{
+	return (x > CTRL_MAX) ? CTRL_MAX : ((x < CTRL_MIN) ? CTRL_MIN : (int32_t)x);
+}
+
+static int32_t ref_sat15_wide(int64_t x)
+{
+	return (x > 32767) ? 32767 : ((x < -32768) ? -32768 : (int32_t)x);
+}
+
+static int32_t ref_sat32(int64_t x)
+{
+	return (x > INT32_MAX) ? INT32_MAX : ((x < INT32_MIN) ? INT32_MIN : (int32_t)x);
+}
+
+// Output of the PI and its flags, as computed by controller.c.
+typedef struct {
+	int32_t u;
+	uint8_t saturated;
+	uint8_t commit_i;
+} pi_out_t;
+
+// The PI output sum before the helpers: exact in 64 bits.
+static pi_out_t ref_pi(int32_t ff, int32_t dob, int32_t p, int32_t i_old, int32_t i_new, int32_t err)
+{
+	pi_out_t o;
+	const int64_t candidate = (int64_t)ff + dob + p + i_new;
+	o.saturated = (ref_sat30_wide(candidate) != candidate);
+	o.commit_i  = !o.saturated || !((candidate > CTRL_MAX && err > 0) || (candidate < CTRL_MIN && err < 0));
+	o.u = ref_sat30_wide((int64_t)ff + dob + p + (o.commit_i ? i_new : i_old));
+	return o;
+}
+
+// The PI output sum of controller.c: Q30 terms chained through QADD.
+static pi_out_t fix_pi(int32_t ff, int32_t dob, int32_t p, int32_t i_old, int32_t i_new, int32_t err)
+{
+	pi_out_t o;
+	const int32_t ff_dob = Fix_QAdd(ff, dob);
+	const int32_t candidate = Fix_QAdd(ff_dob, Q30_AddWide(Q30(p), Q30(i_new)));
+	o.saturated = (Fix_Sat30(candidate) != candidate);
+	o.commit_i  = !o.saturated || !((candidate > CTRL_MAX && err > 0) || (candidate < CTRL_MIN && err < 0));
+	o.u = Fix_Sat30(Fix_QAdd(ff_dob, Q30_AddWide(Q30(p), Q30(o.commit_i ? i_new : i_old))));
+	return o;
+}
+
+// Peripheral_PWM_ControlToCounts() before the helpers: 64-bit product, both ends clipped.
+static int32_t ref_control_to_counts(int32_t ctrl, uint32_t top)
+{
+	ctrl = (ctrl > CTRL_MAX) ? CTRL_MAX : ((ctrl < CTRL_MIN) ? CTRL_MIN : ctrl);
+	int32_t duty = (int32_t)(((int64_t)ctrl * (int64_t)top) >> CTRL_Q);
+	if (duty > (int32_t)top - 1)
+		duty = (int32_t)top - 1;
+	if (duty < -(int32_t)top + 1)
+		duty = -(int32_t)top + 1;
+	return duty;
+}
+
+/* ----------------- Check ----------------- */
+
+typedef struct {
+	const char* name;
+	uint64_t    cases;
+	uint64_t    differ;
+	double      ns_ref, ns_fix;   // Per call
+} check_t;
+
+enum { C_SAT30, C_SAT15, C_QADD, C_QSUB, C_PI, C_COUNTS, C_COUNT };
+
+static check_t checks[C_COUNT] = {
+	[C_SAT30]  = { "sat30_wide" },
+	[C_SAT15]  = { "sat15_wide" },
+	[C_QADD]   = { "qadd" },
+	[C_QSUB]   = { "qsub" },
+	[C_PI]     = { "pi_output" },
+	[C_COUNTS] = { "control_to_counts" },
+};
+
+static void count(check_t* c, int differ)
+{
+	c->cases++;
+	c->differ += (differ != 0);
+	if (differ && c->differ == 1U)
+		printf("%s: first difference at case %llu\n", c->name, (unsigned long long)c->cases);
+}
+
+static void run_checks(uint64_t n)
+{
+	for (uint64_t k = 0; k < n; k++)
+	{
+		const int64_t w = rnd_i64();
+		count(&checks[C_SAT30], Fix_Sat30Wide(w) != ref_sat30_wide(w));
+		count(&checks[C_SAT15], Fix_Sat15Wide(w) != ref_sat15_wide(w));
+
+		const int32_t a = rnd_i32(), b = rnd_i32();
+		count(&checks[C_QADD], Fix_QAdd(a, b) != ref_sat32((int64_t)a + b));
+		count(&checks[C_QSUB], Fix_QSub(a, b) != ref_sat32((int64_t)a - b));
+
+		const int32_t ff = rnd_q30(), dob = rnd_q30(), p = rnd_q30(), i_old = rnd_q30(), i_new = rnd_q30();
+		const int32_t err = (int32_t)(rnd() % 3U) - 1;
+		const pi_out_t r = ref_pi(ff, dob, p, i_old, i_new, err);
+		const pi_out_t f = fix_pi(ff, dob, p, i_old, i_new, err);
+		count(&checks[C_PI], r.u != f.u || r.saturated != f.saturated || r.commit_i != f.commit_i);
+	}
+
+	// Every 16-bit timer period against a spread of controls
+	for (uint32_t top = 1; top <= 65536U; top++)
+	{
+		for (uint64_t k = 0; k < n / 65536U + 16U; k++)
+		{
+			const int32_t ctrl = rnd_i32();
+			count(&checks[C_COUNTS], Peripheral_PWM_ControlToCounts(ctrl, top) != ref_control_to_counts(ctrl, top));
+		}
+	}
+}
+
+/* ----------------- Timing ----------------- */
+
+#define TIME_N 4096   // Inputs per timed pass, small enough to stay in L1
+
+static int64_t  t_w[TIME_N];
+static int32_t  t_a[TIME_N], t_b[TIME_N], t_c[TIME_N], t_d[TIME_N], t_e[TIME_N];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Best of 50 timed passes over the inputs, in ns per call.
+#define TIME_LOOP(result, expr)                                     \
+	do {                                                            \
+		double best = 1e30;                                         \
+		for (int pass = 0; pass < 50; pass++)                       \
+		{                                                           \
+			int64_t acc = 0;                                        \
+			const double t0 = now_ns();                             \
+			for (int j = 0; j < TIME_N; j++)                        \
+				acc += (expr);                                      \
+			const double t = now_ns() - t0;                         \
+			sink = acc;                                             \
+			if (t < best)                                           \
+				best = t;                                           \
+		}                                                           \
+		(result) = best / TIME_N;                                   \
+	} while (0)
+
+static void run_timing(void)
+{
+	for (int j = 0; j < TIME_N; j++)
+	{
+		t_w[j] = rnd_i64();
+		t_a[j] = rnd_q30();
+		t_b[j] = rnd_q30();
+		t_c[j] = rnd_q30();
+		t_d[j] = rnd_q30();
+		t_e[j] = rnd_i32();
+	}
+
+	TIME_LOOP(checks[C_SAT30].ns_ref, ref_sat30_wide(t_w[j]));
+	TIME_LOOP(checks[C_SAT30].ns_fix, Fix_Sat30Wide(t_w[j]));
+	TIME_LOOP(checks[C_SAT15].ns_ref, ref_sat15_wide(t_w[j]));
+	TIME_LOOP(checks[C_SAT15].ns_fix, Fix_Sat15Wide(t_w[j]));
+	TIME_LOOP(checks[C_QADD].ns_ref, ref_sat32((int64_t)t_a[j] + t_e[j]));
+	TIME_LOOP(checks[C_QADD].ns_fix, Fix_QAdd(t_a[j], t_e[j]));
+	TIME_LOOP(checks[C_QSUB].ns_ref, ref_sat32((int64_t)t_a[j] - t_e[j]));
+	TIME_LOOP(checks[C_QSUB].ns_fix, Fix_QSub(t_a[j], t_e[j]));
+	TIME_LOOP(checks[C_PI].ns_ref, ref_pi(t_a[j], t_b[j], t_c[j], t_d[j], t_e[j], t_e[j] >> 31).u);
+	TIME_LOOP(checks[C_PI].ns_fix, fix_pi(t_a[j], t_b[j], t_c[j], t_d[j], t_e[j], t_e[j] >> 31).u);
+	TIME_LOOP(checks[C_COUNTS].ns_ref, ref_control_to_counts(t_e[j], 2048U));
+	TIME_LOOP(checks[C_COUNTS].ns_fix, Peripheral_PWM_ControlToCounts(t_e[j], 2048U));
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	const uint64_t n = (argc > 1) ? strtoull(argv[1], NULL, 0) : 10000000ULL;
+
+	printf("fixedpoint.h %s branch, %llu random cases\n", FIX_ACLE ? "ACLE (emulated)" : "portable", (unsigned long long)n);
+	run_checks(n);
+	run_timing();
+
+	uint64_t differ = 0;
+	printf("%-18s %12s %8s %12s %12s\n", "check", "cases", "differ", "64-bit ns", "helper ns");
+	for (int c = 0; c < C_COUNT; c++)
+	{
+		const check_t* k = &checks[c];
+		printf("%-18s %12llu %8llu %12.2f %12.2f\n", k->name, (unsigned long long)k->cases,
+		       (unsigned long long)k->differ, k->ns_ref, k->ns_fix);
+		differ += k->differ;
+	}
+	printf("%s\n", differ ? "results differ" : "bit-exact");
+
+	return differ ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * Handles the simulated register file of the host build.
+ *
+ * @file hw_host.c
+ *
+ * Stands in for TIM1, TIM3 and GPIOA when the firmware is built with HW_HOST
+ * defined (see hw.h). Every firmware access is counted and logged with a
+ * timestamp, so a host program can check which registers a control step
+ * touches and how often. The model side (e.g. a motor model updating the
+ * encoder count) uses HwHost_Peek()/HwHost_Poke(), which are not recorded.
+ *
+ * Build with the firmware, e.g.
+ *   gcc -O2 -DHW_HOST -Iinclude -Ihost/include source/peripherals.c host/source/hw_host.c <main>.c
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "hw_host.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* ----------------- State ----------------- */
+
+static uint32_t regs[HW_REG_COUNT] = { [HW_TIM3_ARR] = 2047 };
+static uint32_t reads[HW_REG_COUNT];
+static uint32_t writes[HW_REG_COUNT];
+
+static hw_access_t log_buf[HW_HOST_LOG_LEN];
+static size_t      log_len = 0;
+
+static uint64_t (*clock_ns)(void) = NULL;
+
+static const char* const reg_names[HW_REG_COUNT] = {
+	[HW_TIM1_CNT]   = "TIM1_CNT",
+	[HW_TIM3_ARR]   = "TIM3_ARR",
+	[HW_TIM3_CCR1]  = "TIM3_CCR1",
+	[HW_TIM3_CCR2]  = "TIM3_CCR2",
+	[HW_GPIOA_BSRR] = "GPIOA_BSRR",
+	[HW_GPIOA_ODR]  = "GPIOA_ODR",
+};
+
+/* ----------------- Helpers ----------------- */
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void record(hw_reg_t reg, uint32_t value, uint8_t write)
+{
+	if (log_len < HW_HOST_LOG_LEN)
+	{
+		log_buf[log_len++] = (hw_access_t){
+			.time_ns = clock_ns ? clock_ns() : monotonic_ns(),
+			.value   = value,
+			.reg     = (uint8_t)reg,
+			.write   = write,
+		};
+	}
+}
+
+/* ----------------- Firmware side ----------------- */
+
+uint32_t HwHost_Read(hw_reg_t reg)
+{
+	const uint32_t value = (reg == HW_GPIOA_BSRR) ? 0U : regs[reg];
+
+	reads[reg]++;
+	record(reg, value, 0);
+
+	return value;
+}
+
+void HwHost_Write(hw_reg_t reg, uint32_t value)
+{
+	writes[reg]++;
+	record(reg, value, 1);
+
+	switch (reg)
+	{
+		case HW_GPIOA_BSRR: // Reset bits first, set bits win (RM0351 8.4.7)
+			regs[HW_GPIOA_ODR] = (regs[HW_GPIOA_ODR] & ~(value >> 16)) | (value & 0xFFFFU);
+			break;
+		case HW_TIM1_CNT:
+		case HW_TIM3_ARR:
+		case HW_TIM3_CCR1:
+		case HW_TIM3_CCR2:
+			regs[reg] = value & 0xFFFFU; // 16-bit timer registers
+			break;
+		default:
+			regs[reg] = value;
+			break;
+	}
+}
+
+/* ----------------- Model side ----------------- */
+
+uint32_t HwHost_Peek(hw_reg_t reg)
+{
+	return regs[reg];
+}
+
+void HwHost_Poke(hw_reg_t reg, uint32_t value)
+{
+	regs[reg] = value;
+}
+
+void HwHost_Reset(void)
+{
+	for (int i = 0; i < HW_REG_COUNT; i++)
+		regs[i] = 0;
+
+	regs[HW_TIM3_ARR] = 2047;
+	HwHost_ClearLog();
+}
+
+void HwHost_ClearLog(void)
+{
+	for (int i = 0; i < HW_REG_COUNT; i++)
+	{
+		reads[i]  = 0;
+		writes[i] = 0;
+	}
+	log_len = 0;
+}
+
+void HwHost_SetClock(uint64_t (*now_ns)(void))
+{
+	clock_ns = now_ns;
+}
+
+/* ----------------- Inspection ----------------- */
+
+uint32_t HwHost_ReadCount(hw_reg_t reg)
+{
+	return reads[reg];
+}
+
+uint32_t HwHost_WriteCount(hw_reg_t reg)
+{
+	return writes[reg];
+}
+
+size_t HwHost_Log(const hw_access_t** entries)
+{
+	*entries = log_buf;
+	return log_len;
+}
+
+const char* HwHost_RegName(hw_reg_t reg)
+{
+	return ((unsigned)reg < HW_REG_COUNT) ? reg_names[reg] : "?";
+}
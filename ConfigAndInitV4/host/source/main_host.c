@@ -0,0 +1,217 @@
+/**
+ * Runs the RTOS application (app-rtos.c) on Linux in virtual time.
+ *
+ * @file main_host.c
+ *
+ * The unmodified firmware threads run on the CMSIS-RTOS2 emulation, the
+ * peripherals on the host register file and the motor model closes the loop
+ * once per kernel tick. Usage:
+ *   rtos_host [seconds] [--trace] [--telemetry FILE]
+ * --trace prints one CSV line per control sample. --telemetry writes every
+ * control sample to a stream log for replay_host (needs -DTELEMETRY=1).
+ * Without -DTELEMETRY=1, leave out source/telemetry.c.
+ *
+ * Build from ConfigAndInitV4, e.g.
+ *   gcc -O2 -DHW_HOST -DTELEMETRY=1 -Ihost/include -Iinclude -o rtos_host \
+ *       host/source/cmsis_os2_host.c host/source/hw_host.c host/source/main_host.c host/source/motor_model.c \
+ *       source/app-rtos.c source/autotune.c source/controller.c source/ctrlstate.c source/freqresp.c \
+ *       source/ilc.c source/peripherals.c source/position.c source/sysid.c source/telemetry.c source/trajectory.c -lm
+ * and add -DSTACK_WATERMARK=1 to print the stack used by each thread at the
+ * end (on x86-64, the target needs the FPU frame on top, see app-rtos.c).
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "application.h"
+#include "ctrlstate.h"
+#include "lowpower.h"
+#include "telemetry.h"
+#include "main.h"
+#include "cmsis_os2.h"
+#include "os_host.h"
+#include "hw_host.h"
+#include "motor_model.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ----------------- State ----------------- */
+
+#if STACK_WATERMARK
+extern volatile uint32_t STACK_FREE_MAIN, STACK_FREE_CTRL, STACK_FREE_REF; // app-rtos.c
+#endif
+
+static uint8_t  trace = 0;
+static uint32_t last_sample = 0;
+static uint32_t samples = 0;
+static double   err_sq_sum = 0.0;
+
+#if TELEMETRY
+static FILE*    tlm_file = NULL;
+static uint32_t tlm_next = 0;    // Next record to write
+static uint32_t tlm_lost = 0;    // Records overwritten before they were drained
+#endif
+
+/* ----------------- Target stand-ins ----------------- */
+
+uint32_t Main_GetTickMillisec(void)
+{
+	return osKernelGetTickCount() * (1000U / OS_HOST_TICK_FREQ);
+}
+
+// Tickless idle has nothing to save in virtual time, the kernel skips idle ticks anyway.
+void LowPower_Init(void)
+{
+}
+
+/* ----------------- Telemetry ----------------- */
+
+#if TELEMETRY
+
+// Append the records written since the last call, the ring holds TELEMETRY_N.
+static void telemetry_drain(void)
+{
+	telemetry_header_t h;
+	Telemetry_GetHeader(&h);
+
+	if (h.count - tlm_next > TELEMETRY_N)
+	{
+		tlm_lost += h.count - TELEMETRY_N - tlm_next;
+		tlm_next  = h.count - TELEMETRY_N;
+	}
+
+	telemetry_record_t r;
+	for (; tlm_next < h.count && Telemetry_Get(tlm_next, &r); tlm_next++)
+		fwrite(&r, sizeof r, 1, tlm_file);
+}
+
+// Header of the stream log: capture header with capacity 0 and the final count.
+static void telemetry_write_header(void)
+{
+	telemetry_header_t h;
+	Telemetry_GetHeader(&h);
+	h.capacity = 0;
+	h.count    = tlm_next - tlm_lost;
+
+	rewind(tlm_file);
+	fwrite(&h, sizeof h, 1, tlm_file);
+	fseek(tlm_file, 0, SEEK_END);
+}
+#endif
+
+/* ----------------- Plant ----------------- */
+
+static uint64_t virtual_ns(void)
+{
+	return OsHost_TimeNs();
+}
+
+// Runs before the timers of every tick: collect the last sample, then move the motor.
+static void tick_hook(uint32_t tick)
+{
+	ctrl_state_t s;
+	CtrlState_Read(&s);
+
+	if (s.millisec != last_sample)
+	{
+		const double err = (double)s.reference - (double)s.velocity;
+
+		last_sample = s.millisec;
+		samples++;
+		err_sq_sum += err * err;
+
+		if (trace)
+			printf("%u,%d,%d,%d,%.1f\n", (unsigned)s.millisec, (int)s.reference, (int)s.velocity, (int)s.control, Motor_GetVelocity());
+	}
+
+#if TELEMETRY
+	if (tlm_file != NULL)
+		telemetry_drain();
+#endif
+
+	Motor_Step(1.0 / OS_HOST_TICK_FREQ);
+	(void)tick;
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	double seconds = 20.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--trace") == 0)
+			trace = 1;
+		else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+		{
+#if TELEMETRY
+			tlm_file = fopen(argv[++i], "wb");
+			if (tlm_file == NULL)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+#else
+			fprintf(stderr, "--telemetry: built without -DTELEMETRY=1\n");
+			return 1;
+#endif
+		}
+		else
+			seconds = atof(argv[i]);
+	}
+
+	const motor_params_t motor = MOTOR_PARAMS_DEFAULT;
+	HwHost_Reset();
+	HwHost_SetClock(virtual_ns);
+	Motor_Init(&motor);
+
+	OsHost_SetTickHook(tick_hook);
+	OsHost_SetHorizon((uint32_t)(seconds * OS_HOST_TICK_FREQ));
+
+	if (trace)
+		printf("millisec,reference,velocity,control,motor_rpm\n");
+#if TELEMETRY
+	if (tlm_file != NULL)
+		telemetry_write_header(); // Placeholder, rewritten with the count at the end
+#endif
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Application_Setup(); // Returns when the kernel reaches the horizon
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+#if TELEMETRY
+	if (tlm_file != NULL)
+	{
+		telemetry_drain();
+		telemetry_write_header();
+		fclose(tlm_file);
+		fprintf(stderr, "telemetry %u records, %u lost\n", tlm_next - tlm_lost, tlm_lost);
+	}
+#endif
+
+	const double wall = (double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+	const double virt = (double)osKernelGetTickCount() / OS_HOST_TICK_FREQ;
+	os_host_stats_t st;
+	OsHost_GetStats(&st);
+
+	uint32_t writes = 0;
+	for (int r = 0; r < HW_REG_COUNT; r++)
+		writes += HwHost_WriteCount((hw_reg_t)r);
+
+	fprintf(stderr, "virtual %.1f s in %.3f s wall (%.0fx real time)\n", virt, wall, (wall > 0.0) ? virt / wall : 0.0);
+	fprintf(stderr, "switches %u, preemptions %u, timer callbacks %u\n", st.switches, st.preemptions, st.timer_fires);
+#if STACK_WATERMARK
+	// Host threads get OS_HOST_STACK_MIN, x86-64 frames are larger than Thumb-2 ones and have no FPU context
+	fprintf(stderr, "stack used (x86-64) app_main %u, app_ctrl %u, app_ref %u bytes\n",
+	        OS_HOST_STACK_MIN - STACK_FREE_MAIN, OS_HOST_STACK_MIN - STACK_FREE_CTRL, OS_HOST_STACK_MIN - STACK_FREE_REF);
+#endif
+	fprintf(stderr, "control samples %u, RMS error %.1f RPM, register writes per sample %.2f\n",
+	        samples, (samples > 0U) ? sqrt(err_sq_sum / samples) : 0.0, (samples > 0U) ? (double)writes / samples : 0.0);
+
+	return 0;
+}
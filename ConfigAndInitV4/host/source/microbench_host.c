@@ -0,0 +1,107 @@
+/**
+ * Runs the microbenchmarks (microbench.c) on Linux.
+ *
+ * @file microbench_host.c
+ *
+ * The cycle source is the x86 time stamp counter, read with RDTSCP so the
+ * call has finished before the second read; its rate is calibrated against
+ * the monotonic clock and printed, to convert ticks to ns. Other hosts fall
+ * back to the monotonic clock in ns. Usage:
+ *   microbench_host [repeats]
+ * Each case is run 'repeats' times (default 5) and the lowest min/median/max
+ * of the runs is reported, which filters out interference from the machine.
+ *
+ * Build from ConfigAndInitV4, e.g.
+ *   gcc -O2 -DHW_HOST -Ihost/include -Iinclude -o microbench_host \
+ *       host/source/microbench_host.c host/source/hw_host.c \
+ *       source/microbench.c source/controller.c source/peripherals.c -lm
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "microbench.h"
+#include "hw_host.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#define HOST_TSC 1
+#else
+#define HOST_TSC 0
+#endif
+
+/* ----------------- Cycle source ----------------- */
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t Microbench_Cycles(void)
+{
+#if HOST_TSC
+	unsigned int aux;
+	return (uint32_t)__rdtscp(&aux);
+#else
+	return (uint32_t)monotonic_ns();
+#endif
+}
+
+// Counter ticks per ns, measured over 50 ms.
+static double ticks_per_ns(void)
+{
+#if HOST_TSC
+	const uint64_t n0 = monotonic_ns();
+	const uint64_t c0 = __rdtsc();
+	while (monotonic_ns() - n0 < 50000000ULL)
+		;
+	return (double)(__rdtsc() - c0) / (double)(monotonic_ns() - n0);
+#else
+	return 1.0;
+#endif
+}
+
+// Register accesses are still logged, but not timestamped inside the timed calls.
+static uint64_t no_clock(void)
+{
+	return 0;
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	const int repeats = (argc > 1) ? atoi(argv[1]) : 5;
+	const double rate = ticks_per_ns();
+
+	HwHost_SetClock(no_clock);
+
+	printf("%-38s %8s %8s %8s   (%s, %.3f per ns)\n", "function", "min", "median", "max", HOST_TSC ? "TSC ticks" : "ns", rate);
+
+	for (int c = 0; c < MB_CASE_COUNT; c++)
+	{
+		mb_result_t best = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+		for (int r = 0; r < repeats; r++)
+		{
+			mb_result_t res;
+			HwHost_ClearLog(); // Keep the log in the pages already touched
+			Microbench_Run((mb_case_t)c, &res);
+			if (res.min < best.min)
+				best.min = res.min;
+			if (res.median < best.median)
+				best.median = res.median;
+			if (res.max < best.max)
+				best.max = res.max;
+		}
+
+		printf("%-38s %8u %8u %8u\n", Microbench_Name((mb_case_t)c), best.min, best.median, best.max);
+	}
+
+	return 0;
+}
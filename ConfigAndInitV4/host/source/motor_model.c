@@ -0,0 +1,78 @@
+/**
+ * Handles the simulated DC motor and encoder of the host build.
+ *
+ * @file motor_model.c
+ *
+ * The motor sits on the other side of the host register file: the PWM
+ * compare values and half-bridge enables the firmware writes are its input,
+ * the quadrature encoder count in TIM1_CNT is its output.
+ */
+
+#include "motor_model.h"
+#include "hw_host.h"
+#include <math.h>
+#include <stdint.h>
+
+/* ----------------- Config ----------------- */
+
+#define ENCODER_COUNTS_PER_REV 2048   // 512 PPR, quadrature decoding
+#define STANDSTILL_RPM         0.5    // Below this the motor is held by stiction
+
+/* ----------------- State ----------------- */
+
+static motor_params_t p;
+static double velocity = 0.0;   // RPM
+static double position = 0.0;   // Encoder counts
+
+/* ----------------- Helpers ----------------- */
+
+// Duty in [-1, 1] from the register file, clockwise positive (CCR2).
+static double read_duty(void)
+{
+	const uint32_t enabled = (1U << 5) | (1U << 6); // PA5, PA6
+
+	if ((HwHost_Peek(HW_GPIOA_ODR) & enabled) != enabled)
+		return 0.0;
+
+	const double top = (double)HwHost_Peek(HW_TIM3_ARR) + 1.0;
+	return ((double)HwHost_Peek(HW_TIM3_CCR2) - (double)HwHost_Peek(HW_TIM3_CCR1)) / top;
+}
+
+/* ----------------- API ----------------- */
+
+void Motor_Init(const motor_params_t* params)
+{
+	p        = *params;
+	velocity = 0.0;
+	position = 0.0;
+	HwHost_Poke(HW_TIM1_CNT, 0);
+}
+
+void Motor_Step(double dt_s)
+{
+	const double drive = read_duty() * p.gain_rpm;
+	const double fric  = p.fric_rpm + p.load_rpm;
+	double target;
+
+	if (fabs(velocity) > STANDSTILL_RPM)
+		target = drive - ((velocity > 0.0) ? fric : -fric);           // Sliding
+	else if (fabs(drive) < 1.5 * p.fric_rpm)
+		target = 0.0;                                                 // Stuck
+	else
+		target = drive - ((drive > 0.0) ? 1.5 * fric : -1.5 * fric);  // Breakaway
+
+	velocity += (target - velocity) * dt_s / p.tau_s;
+	position += velocity * dt_s * (ENCODER_COUNTS_PER_REV / 60.0);
+
+	HwHost_Poke(HW_TIM1_CNT, (uint32_t)(int64_t)floor(position) & 0xFFFFU);
+}
+
+double Motor_GetVelocity(void)
+{
+	return velocity;
+}
+
+void Motor_SetLoad(double load_rpm)
+{
+	p.load_rpm = load_rpm;
+}
@@ -0,0 +1,260 @@
+/**
+ * Replays telemetry logs (telemetry.h) through the controller on Linux.
+ *
+ * @file replay_host.c
+ *
+ * Steps Controller_PIController() of this build through the recorded
+ * inputs, with the calls in the same order as app-rtos.c, and compares its
+ * output with the recorded one bit for bit. The recorded velocity and
+ * applied control are fed back as they were, so every sample is compared on
+ * the inputs the original controller saw. Usage:
+ *   replay_host LOG [--list N] [--write OUT]
+ * --list prints the first N differing samples (default 10, 0 for none).
+ * --write saves a stream log with the replayed outputs as 'law', so the
+ * output of this build can be replayed through another one. The exit status
+ * is 0 when all outputs match, 1 when some differ and 2 for an unreadable
+ * log, so the tool can drive "git bisect run".
+ *
+ * Build from ConfigAndInitV4, e.g.
+ *   gcc -O2 -DHW_HOST -Ihost/include -Iinclude -o replay_host \
+ *       host/source/replay_host.c source/controller.c -lm
+ * and add e.g. -DCONTROLLER_LAW=1 to replay another law.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "controller.h"
+#include "telemetry.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK 65536   // Records per read
+
+/* ----------------- Log reader ----------------- */
+
+typedef struct {
+	FILE*               file;
+	telemetry_header_t  header;
+	telemetry_record_t* ring;     // Whole ring of a ring image, NULL for a stream log
+	uint32_t            next;     // Next ring record to hand out
+	uint32_t            left;     // Ring records left
+} log_reader_t;
+
+// Read and check the header, load the records of a ring image. Returns 0 on a bad log.
+static int log_open(log_reader_t* l, const char* path)
+{
+	memset(l, 0, sizeof *l);
+	l->file = fopen(path, "rb");
+	if (l->file == NULL)
+	{
+		perror(path);
+		return 0;
+	}
+
+	telemetry_header_t* h = &l->header;
+	if (fread(h, sizeof *h, 1, l->file) != 1 || h->magic != TELEMETRY_MAGIC)
+	{
+		fprintf(stderr, "%s: not a telemetry log\n", path);
+		return 0;
+	}
+	if (h->version != TELEMETRY_VERSION || h->record_size != sizeof (telemetry_record_t))
+	{
+		fprintf(stderr, "%s: format version %u with %u-byte records, this build reads version %u with %u-byte records\n",
+		        path, h->version, h->record_size, TELEMETRY_VERSION, (unsigned)sizeof (telemetry_record_t));
+		return 0;
+	}
+
+	if (h->capacity > 0U)
+	{
+		l->ring = malloc((size_t)h->capacity * sizeof (telemetry_record_t));
+		if (l->ring == NULL || fread(l->ring, sizeof (telemetry_record_t), h->capacity, l->file) != h->capacity)
+		{
+			fprintf(stderr, "%s: ring image shorter than its %u records\n", path, h->capacity);
+			return 0;
+		}
+		l->left = (h->count < h->capacity) ? h->count : h->capacity;
+		l->next = (h->count > h->capacity) ? h->count % h->capacity : 0U; // Oldest record
+	}
+	return 1;
+}
+
+// Copy up to 'max' records in time order into 'buf', returns 0 at the end of the log.
+static size_t log_read(log_reader_t* l, telemetry_record_t* buf, size_t max)
+{
+	if (l->ring == NULL)
+		return fread(buf, sizeof (telemetry_record_t), max, l->file);
+
+	size_t n = 0;
+	for (; n < max && l->left > 0U; n++, l->left--)
+	{
+		buf[n] = l->ring[l->next];
+		l->next = (l->next + 1U) % l->header.capacity;
+	}
+	return n;
+}
+
+static void log_close(log_reader_t* l)
+{
+	if (l->file != NULL)
+		fclose(l->file);
+	free(l->ring);
+}
+
+/* ----------------- Main ----------------- */
+
+int main(int argc, char** argv)
+{
+	const char* path = NULL;
+	const char* out_path = NULL;
+	long list = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--list") == 0 && i + 1 < argc)
+			list = atol(argv[++i]);
+		else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc)
+			out_path = argv[++i];
+		else
+			path = argv[i];
+	}
+	if (path == NULL)
+	{
+		fprintf(stderr, "usage: replay_host LOG [--list N] [--write OUT]\n");
+		return 2;
+	}
+
+	log_reader_t log;
+	if (!log_open(&log, path))
+	{
+		log_close(&log);
+		return 2;
+	}
+
+	const telemetry_header_t* h = &log.header;
+	if (h->law != CONTROLLER_LAW)
+		printf("recorded with CONTROLLER_LAW %u, replaying CONTROLLER_LAW %u\n", h->law, (unsigned)CONTROLLER_LAW);
+
+	FILE* out = NULL;
+	telemetry_header_t out_header = *h;
+	if (out_path != NULL)
+	{
+		out = fopen(out_path, "wb");
+		if (out == NULL)
+		{
+			perror(out_path);
+			log_close(&log);
+			return 2;
+		}
+		out_header.law      = CONTROLLER_LAW;
+		out_header.capacity = 0;
+		fwrite(&out_header, sizeof out_header, 1, out); // Rewritten with the count at the end
+	}
+
+	// The controller as it was at the capture start
+	Controller_SetParams(&h->params);
+	Controller_Reset();
+
+	telemetry_record_t* buf = malloc(CHUNK * sizeof (telemetry_record_t));
+	if (buf == NULL)
+	{
+		log_close(&log);
+		return 2;
+	}
+
+	uint32_t samples = 0, steps = 0, differ = 0, gaps = 0;
+	uint32_t expect = 0, first_seq = 0, first_ms = 0;
+	int64_t max_diff = 0;
+	int stop = 0;
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	size_t n;
+	while (!stop && (n = log_read(&log, buf, CHUNK)) > 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			telemetry_record_t* r = &buf[i];
+
+			if (samples == 0 && r->seq != 0U)
+				printf("log starts at seq %u, not at the capture start: the learned state is unknown, early differences are expected\n", r->seq);
+			else if (samples > 0 && r->seq != expect)
+			{
+				printf("seq %u: %u samples missing, later differences may follow from the gap\n", expect, r->seq - expect);
+				gaps++;
+			}
+			expect = r->seq + 1U;
+
+			if (r->flags & TELEMETRY_F_PARAMS)
+			{
+				printf("seq %u: the controller switched to parameters that are not in the log, comparison stops\n", r->seq);
+				stop = 1;
+				n = i; // Samples before it are written
+				break;
+			}
+
+			// Same calls and order as app_ctrl, app_law and app_actuate
+			if (r->flags & TELEMETRY_F_RESET)
+				Controller_Reset();
+			Controller_SetReferenceRate(r->ref_rate);
+
+			int32_t law = 0;
+			if (!(r->flags & TELEMETRY_F_NOLAW))
+			{
+				Controller_FreezeAdaptation((r->flags & TELEMETRY_F_FROZEN) != 0U);
+				law = Controller_PIController(&r->reference, &r->velocity, &r->millisec);
+				steps++;
+
+				if (law != r->law)
+				{
+					const int64_t d = (int64_t)law - r->law;
+					if (differ == 0U)
+					{
+						first_seq = r->seq;
+						first_ms  = r->millisec;
+						if (list > 0)
+							printf("%10s %10s %9s %9s %11s %11s %11s\n", "seq", "millisec", "reference", "velocity", "recorded", "replayed", "diff");
+					}
+					if ((long)differ < list)
+						printf("%10u %10u %9d %9d %11d %11d %11lld\n", r->seq, r->millisec, r->reference, r->velocity, r->law, law, (long long)d);
+					if (d > max_diff || -d > max_diff)
+						max_diff = (d < 0) ? -d : d;
+					differ++;
+				}
+			}
+			Controller_SetAppliedControl(r->control);
+
+			r->law = law;
+			samples++;
+		}
+
+		if (out != NULL)
+			fwrite(buf, sizeof (telemetry_record_t), n, out);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	const double wall = (double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+
+	if (out != NULL)
+	{
+		out_header.count = samples;
+		rewind(out);
+		fwrite(&out_header, sizeof out_header, 1, out);
+		fclose(out);
+	}
+	free(buf);
+	log_close(&log);
+
+	printf("%u samples, %u controller steps in %.3f s (%.1f M samples/s)\n",
+	       samples, steps, wall, (wall > 0.0) ? samples / wall * 1e-6 : 0.0);
+	if (differ == 0U)
+		printf("outputs identical%s\n", (gaps > 0U) ? ", log has gaps" : "");
+	else
+		printf("%u outputs differ, first at seq %u (%u ms), max |diff| %lld (Q30)\n",
+		       differ, first_seq, first_ms, (long long)max_diff);
+
+	return (differ == 0U) ? 0 : 1;
+}
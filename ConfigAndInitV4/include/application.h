@@ -6,6 +6,16 @@ extern "C" {
 
 #define PERIOD_CTRL 10		//!< Period of the control loop in milliseconds.
 #define PERIOD_REF 4000		//!< Period of the reference switch in milliseconds.
+#define REF_AMPLITUDE_RPM 2000	//!< Magnitude of the switched reference in RPM.
+#define REF_ACCEL_RPM_S 20000	//!< Acceleration limit of the reference profile in RPM per second.
+#define CTRL_BENCH 0		//!< 1 = measure every controller step in CPU cycles (DWT) and its tracking error, see app-rtos.c.
+#define MICROBENCH 0		//!< 1 = time the hot-path functions in isolation at setup, results in MICROBENCH_RESULTS (see microbench.h).
+#ifndef STACK_WATERMARK
+#define STACK_WATERMARK 0	//!< 1 = report the unused stack of every thread in STACK_FREE_* (needs OS_STACK_WATERMARK in RTX_Config.h), see app-rtos.c.
+#endif
+#ifndef TELEMETRY
+#define TELEMETRY 0		//!< 1 = record every control sample for host replay, see telemetry.h (set in the build to switch).
+#endif
 
 /**
  * @brief Initializes the application.
@@ -0,0 +1,66 @@
+#ifndef _AUTOTUNE_H_
+#define _AUTOTUNE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef AUTOTUNE_AT_SETUP
+#define AUTOTUNE_AT_SETUP 0   //!< Set to 1 to run the relay autotune once from Application_Setup().
+#endif
+
+/**
+ * @brief Result of the last relay experiment.
+ */
+typedef struct {
+	uint8_t  status;     //!< 0 = never run, 1 = running, 2 = done, 3 = failed (timeout).
+	int32_t  ku;         //!< Ultimate gain (Q30 per RPM).
+	uint32_t tu_ms;      //!< Ultimate period in milliseconds.
+	int32_t  amp_rpm;    //!< Measured limit cycle amplitude in RPM.
+	int32_t  kp;         //!< Computed proportional gain (Q15), see ctrl_params_t.
+	int32_t  ki;         //!< Computed integral gain per second (Q15), see ctrl_params_t.
+} autotune_result_t;
+
+/**
+ * @brief Start a relay autotune experiment.
+ *
+ * The experiment takes over the motor from the next control step, runs for a
+ * few seconds and then writes the new PI gains with Controller_SetParams().
+ * It can also be started by setting AUTOTUNE_REQUEST to 1 in Watch.
+ * It doesn't take any arguments and doesn't return any value.
+ */
+void Autotune_Start(void);
+
+/**
+ * @brief Check whether the autotune experiment owns the motor.
+ *
+ * @return Non-zero while the experiment is running.
+ */
+uint8_t Autotune_IsActive(void);
+
+/**
+ * @brief Run one control period of the relay experiment.
+ *
+ * This function replaces Controller_PIController() while Autotune_IsActive()
+ * is true. It drives a relay around AUTOTUNE_SETPOINT_RPM, measures the limit
+ * cycle and computes the PI gains when enough periods have been seen.
+ *
+ * @param meas_rpm The measured velocity in RPM.
+ * @param millisec The timestamp in milliseconds.
+ * @return The control signal for the motor (Q30).
+ */
+int32_t Autotune_Step(int32_t meas_rpm, uint32_t millisec);
+
+/**
+ * @brief Read the result of the last experiment.
+ *
+ * @param result Pointer to where the result is copied.
+ */
+void Autotune_GetResult(autotune_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _AUTOTUNE_H_
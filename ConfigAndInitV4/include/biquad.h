@@ -0,0 +1,112 @@
+#ifndef _BIQUAD_H_
+#define _BIQUAD_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Coefficients and output limits of one second-order section.
+ *
+ * A section computes, in direct form I,
+ *   y[k] = b0 x[k] + b1 x[k-1] + b2 x[k-2] - a1 y[k-1] - a2 y[k-2]
+ * with the coefficients in the Q-format of its cascade. The output is
+ * saturated to [y_min, y_max] before it is stored, so a section with a pole
+ * at 1 (a1 = -1, an integrator) is bounded like a clamped integrator.
+ * First-order sections simply set b2 = a2 = 0.
+ */
+typedef struct {
+	int32_t b0, b1, b2;    //!< Numerator coefficients (Q of the cascade).
+	int32_t a1, a2;        //!< Denominator coefficients, without the leading 1 (Q of the cascade).
+	int32_t y_min, y_max;  //!< Output limits of the section.
+} biquad_coef_t;
+
+/**
+ * @brief Delay line of one second-order section.
+ */
+typedef struct {
+	int32_t x1, x2;        //!< Previous inputs.
+	int32_t y1, y2;        //!< Previous (saturated) outputs.
+} biquad_state_t;
+
+#if defined (__ARMCC_VERSION) || defined (__clang__)
+#define BIQUAD_UNROLL _Pragma("unroll")
+#elif defined (__GNUC__)
+#define BIQUAD_UNROLL _Pragma("GCC unroll 8")
+#else
+#define BIQUAD_UNROLL
+#endif
+
+/**
+ * @brief Run one sample through one section.
+ *
+ * The five products are summed in 64 bits (SMLAL on the Cortex-M4), rounded
+ * once and shifted back by q. Coefficients must stay below 2^(31 - q) in
+ * magnitude, i.e. q = 16 allows gains up to 32767.
+ *
+ * @param c Pointer to the section's coefficients.
+ * @param s Pointer to the section's delay line.
+ * @param x The input sample.
+ * @param q Fractional bits of the coefficients, a compile-time constant.
+ * @return The saturated output sample.
+ */
+static inline int32_t Biquad_Section(const biquad_coef_t* c, biquad_state_t* s, int32_t x, const int q)
+{
+	int64_t acc = (int64_t)1 << (q - 1);
+	acc += (int64_t)c->b0 * x;
+	acc += (int64_t)c->b1 * s->x1;
+	acc += (int64_t)c->b2 * s->x2;
+	acc -= (int64_t)c->a1 * s->y1;
+	acc -= (int64_t)c->a2 * s->y2;
+	acc >>= q;
+
+	const int32_t y = (acc > c->y_max) ? c->y_max : ((acc < c->y_min) ? c->y_min : (int32_t)acc);
+	s->x2 = s->x1;
+	s->x1 = x;
+	s->y2 = s->y1;
+	s->y1 = y;
+	return y;
+}
+
+/**
+ * @brief Define a cascade of second-order sections with compile-time order and Q-format.
+ *
+ * Expands to a type name##_t holding the coefficients and delay lines of the
+ * given number of sections, and two static inline functions:
+ *   void    name##_reset(name##_t* f);              // Clear the delay lines
+ *   int32_t name##_step(name##_t* f, int32_t x);    // One sample through all sections
+ * The section loop has a constant trip count and is unrolled, and the shift
+ * by q is an immediate, so the step compiles to straight-line code.
+ * Use it at file scope in a C source file.
+ *
+ * @param name Prefix of the generated type and functions.
+ * @param stages Number of sections, 1 to 8.
+ * @param q Fractional bits of all coefficients, 1 to 30.
+ */
+#define BIQUAD_CASCADE_DEFINE(name, stages, q)                                     \
+	_Static_assert((stages) >= 1 && (stages) <= 8, #name ": 1 to 8 sections");     \
+	_Static_assert((q) >= 1 && (q) <= 30, #name ": Q-format must be 1 to 30");     \
+	typedef struct {                                                               \
+		biquad_coef_t c[stages];                                                   \
+		biquad_state_t s[stages];                                                  \
+	} name##_t;                                                                    \
+	static inline void name##_reset(name##_t* f)                                   \
+	{                                                                              \
+		BIQUAD_UNROLL                                                              \
+		for (int i = 0; i < (stages); i++)                                         \
+			f->s[i] = (biquad_state_t){ 0 };                                       \
+	}                                                                              \
+	static inline int32_t name##_step(name##_t* f, int32_t x)                      \
+	{                                                                              \
+		BIQUAD_UNROLL                                                              \
+		for (int i = 0; i < (stages); i++)                                         \
+			x = Biquad_Section(&f->c[i], &f->s[i], x, (q));                        \
+		return x;                                                                  \
+	}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _BIQUAD_H_
@@ -10,6 +10,33 @@ extern "C" {
 #include <arm_acle.h>
 #endif
 
+#define CONTROLLER_LAW_PI      0   //!< Hand-written PI with windowed, clamped integrator (kp, ki, int_window_rpm, i_clamp).
+#define CONTROLLER_LAW_CASCADE 1   //!< Cascade of second-order sections, PI section from kp, ki and i_clamp, see controller.c.
+#define CONTROLLER_LAW_PI_F32  2   //!< The PI and feedforward law in float32 on the FPU, same parameters as CONTROLLER_LAW_PI.
+
+#ifndef CONTROLLER_LAW
+#define CONTROLLER_LAW CONTROLLER_LAW_PI   //!< Feedback law on the speed error, set in the build to switch.
+#endif
+
+#define RPM_SCALE 6000   //!< Speed normalised to 1.0 (Q15) before the gains, errors up to ~4000 RPM expected.
+
+/**
+ * @brief Tunable controller parameters.
+ */
+typedef struct {
+	int32_t kp;               //!< Proportional gain (Q15).
+	int32_t ki;               //!< Integral gain per second (Q15).
+	int32_t u_per_rpm;        //!< Feedforward slope (Q30 per RPM), 0 disables feedforward.
+	int32_t u_per_rpm_s;      //!< Feedforward on the reference derivative (Q30 per RPM/s), 0 disables it.
+	int32_t err_deadband_rpm; //!< Errors up to this size (RPM) are treated as zero.
+	int32_t int_window_rpm;   //!< The integrator only updates while |error| is within this window (RPM).
+	int32_t i_clamp;          //!< Integrator limit (Q30).
+	int32_t ff_adapt_rate;    //!< Step size of the feedforward adaptation (Q16), 0 keeps the feedforward fixed.
+	int32_t fric_band_rpm;    //!< Speed band (RPM) of the friction blending and breakaway, 0 disables both.
+	int32_t dob_tau_ms;       //!< Nominal motor time constant (ms) of the disturbance observer, 0 disables it.
+	int32_t dob_q_ms;         //!< Time constant (ms) of the observer's low-pass Q-filter.
+} ctrl_params_t;
+
 /**
  * @brief Apply a PI-control law to calculate the control signal for the motor.
  *
@@ -28,11 +55,93 @@ int32_t Controller_PIController(const int32_t* reference, const int32_t* measure
  * @brief Reset internal state variables, such as the integrator.
  *
  * This function triggers a reset of the internal state variables of the controller,
- * including the integrator, to their initial values.
+ * including the integrator, to their initial values. The learned feedforward
+ * and friction are cleared too, learning restarts from u_per_rpm.
  * It doesn't take any arguments and doesn't return any value.
  */
 void Controller_Reset(void);
 
+/**
+ * @brief Set the derivative of the reference for the next controller step.
+ *
+ * The derivative is used for feedforward only (see u_per_rpm_s). It keeps its
+ * value until it is set again.
+ *
+ * @param rate_rpm_s Reference derivative in RPM per second.
+ */
+void Controller_SetReferenceRate(int32_t rate_rpm_s);
+
+/**
+ * @brief Report the control signal that was actually applied to the motor.
+ *
+ * The disturbance observer and the feedforward adaptation need the real
+ * motor input. Call this after any stage that adds to the controller output
+ * (learning, excitation), so those additions are not mistaken for load.
+ * Without the call the controller's own output is used.
+ *
+ * @param control The applied control signal (Q30).
+ */
+void Controller_SetAppliedControl(int32_t control);
+
+/**
+ * @brief Read the disturbance observer's load estimate.
+ *
+ * @return The estimated load as control signal (Q30), already added to the output.
+ */
+int32_t Controller_GetDisturbance(void);
+
+/**
+ * @brief Freeze or release the online feedforward adaptation.
+ *
+ * While frozen, the learned feedforward is still applied but not updated.
+ * Use it whenever the loop is excited on purpose (identification, sweeps).
+ *
+ * @param freeze Non-zero to freeze, zero to release.
+ */
+void Controller_FreezeAdaptation(uint8_t freeze);
+
+/**
+ * @brief Read the learned feedforward.
+ *
+ * The slope starts from u_per_rpm and restarts whenever a parameter set with
+ * a different u_per_rpm is swapped in.
+ *
+ * @param slope Pointer to where the slope (Q30 per RPM) is written.
+ * @param offset Pointer to where the offset (Q30, applied with the sign of the reference) is written.
+ */
+void Controller_GetFeedforward(int32_t* slope, int32_t* offset);
+
+/**
+ * @brief Read the learned friction compensation.
+ *
+ * The Coulomb term is the learned feedforward offset. The breakaway term is
+ * added on top of it at standstill and fades out at fric_band_rpm.
+ *
+ * @param coulomb Pointer to where the Coulomb term (Q30) is written.
+ * @param breakaway Pointer to where the breakaway term (Q30) is written.
+ */
+void Controller_GetFriction(int32_t* coulomb, int32_t* breakaway);
+
+/**
+ * @brief Request a new set of controller parameters.
+ *
+ * This function stages a complete parameter set. The controller swaps it in
+ * atomically at the start of its next step and recomputes the derived
+ * constants once, so a step never mixes old and new values.
+ * Must not be called from a context that can preempt the control thread.
+ *
+ * @param params Pointer to the new parameters.
+ */
+void Controller_SetParams(const ctrl_params_t* params);
+
+/**
+ * @brief Read the parameters currently used by the controller.
+ *
+ * @param params Pointer to where the active parameters are copied.
+ * @return The version of the active parameter set, incremented on every swap.
+ */
+uint32_t Controller_GetParams(ctrl_params_t* params);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,125 @@
+#ifndef _CTRLDESIGN_H_
+#define _CTRLDESIGN_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "biquad.h"
+
+/*
+ * Compile-time discretisation of continuous-time controller designs.
+ *
+ * Every macro takes the design in continuous time and expands to a
+ * biquad_coef_t initializer in the Q-format of the cascade, for a static
+ * (const) initializer. The arguments are integer constants: time constants
+ * and the sample time in any one unit (e.g. ns, only their ratios matter)
+ * and gains in thousandths. All arithmetic is integer and folded by the
+ * compiler, so the expansions are constant expressions and no floating
+ * point is involved on any toolchain.
+ *
+ * The design checks are part of the expansion: a coefficient that does not
+ * fit 32 bits at the chosen Q, a non-positive time constant, or a design
+ * outside the validity of the method. A failed check is a negative array
+ * size, which stops the build with the name of the check, e.g.
+ * "size of array 'coefficient_out_of_range' is negative".
+ */
+
+/* ----------------- Building blocks ----------------- */
+
+// 0 if cond holds, otherwise a compile error naming 'what'. cond must be an integer constant expression.
+#define DESIGN_REQUIRE(cond, what) ((int32_t)(0 * sizeof (struct { char what[(cond) ? 1 : -1]; })))
+
+// num / den rounded to Q-format q, checked against the int32 range.
+#define DESIGN_Q(num, den, q)                                                                                   \
+	((int32_t)(((int64_t)(num) * (1LL << (q)) + (((num) >= 0) ? (den) / 2 : -(den) / 2)) / (den)) +            \
+	 DESIGN_REQUIRE((den) > 0 && ((int64_t)(num) * (1LL << (q))) / (den) < 2147483647LL &&                     \
+	                ((int64_t)(num) * (1LL << (q))) / (den) > -2147483647LL, coefficient_out_of_range))
+
+// exp(-t / tau) in Q30 for 0 <= t <= tau (Taylor series to x^8, error below 3e-6), Horner in int64.
+#define DESIGN_EXP_X(t, tau)       (((int64_t)(t) << 30) / (tau))
+#define DESIGN_EXP_T(x, k, inner)  ((1LL << 30) - (((x) * (inner)) >> 30) / (k))
+#define DESIGN_EXP_NEG_Q30(t, tau)                                                                        \
+	DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 1, DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 2,                              \
+	DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 3, DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 4,                              \
+	DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 5, DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 6,                              \
+	DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 7, DESIGN_EXP_T(DESIGN_EXP_X(t, tau), 8, 1LL << 30))))))))
+
+#define DESIGN_SECTION(b0_, b1_, a1_, den, q, lo, hi)                                             \
+	{ .b0 = DESIGN_Q(b0_, den, q), .b1 = DESIGN_Q(b1_, den, q), .b2 = 0,                          \
+	  .a1 = DESIGN_Q(a1_, den, q), .a2 = 0, .y_min = (lo), .y_max = (hi) }
+
+/* ----------------- PI: C(s) = kp (1 + 1 / (ti s)) ----------------- */
+
+/**
+ * @brief PI section, Tustin (trapezoidal) integration.
+ *
+ * @param kp_m Proportional gain in thousandths (output units per input unit).
+ * @param ti Integral time.
+ * @param t Sample time, same unit as ti.
+ * @param q Q-format of the cascade.
+ * @param lo, hi Output limits, which also bound the integrator (anti-windup).
+ */
+#define DESIGN_PI_TUSTIN(kp_m, ti, t, q, lo, hi)                                                  \
+	DESIGN_SECTION((int64_t)(kp_m) * (2 * (ti) + (t)) +                                           \
+	               DESIGN_REQUIRE((ti) > 0 && (t) > 0, pi_times_must_be_positive),               \
+	               -(int64_t)(kp_m) * (2 * (ti) - (t)), -2000 * (int64_t)(ti), 2000 * (int64_t)(ti), q, lo, hi)
+
+/**
+ * @brief PI section, zero-order hold (step-invariant) integration.
+ *
+ * Parameters as DESIGN_PI_TUSTIN().
+ */
+#define DESIGN_PI_ZOH(kp_m, ti, t, q, lo, hi)                                                     \
+	DESIGN_SECTION((int64_t)(kp_m) * (ti) +                                                       \
+	               DESIGN_REQUIRE((ti) > 0 && (t) > 0, pi_times_must_be_positive),               \
+	               -(int64_t)(kp_m) * ((ti) - (t)), -1000 * (int64_t)(ti), 1000 * (int64_t)(ti), q, lo, hi)
+
+/* ----------------- Low-pass: H(s) = 1 / (tau s + 1) ----------------- */
+
+/**
+ * @brief First-order low-pass section with unit DC gain, Tustin.
+ *
+ * @param tau Time constant.
+ * @param t Sample time, same unit as tau.
+ * @param q Q-format of the cascade.
+ * @param lo, hi Output limits.
+ */
+#define DESIGN_LOWPASS_TUSTIN(tau, t, q, lo, hi)                                                  \
+	DESIGN_SECTION((int64_t)(t) + DESIGN_REQUIRE((tau) > 0 && (t) > 0, lowpass_times_must_be_positive), \
+	               (int64_t)(t), (int64_t)(t) - 2 * (int64_t)(tau), 2 * (int64_t)(tau) + (t), q, lo, hi)
+
+/**
+ * @brief First-order low-pass section with unit DC gain, zero-order hold.
+ *
+ * Exact for a piecewise constant input, one sample of delay (b0 = 0).
+ * Requires t <= tau, the range of DESIGN_EXP_NEG_Q30().
+ * Parameters as DESIGN_LOWPASS_TUSTIN().
+ */
+#define DESIGN_LOWPASS_ZOH(tau, t, q, lo, hi)                                                     \
+	DESIGN_SECTION(0 + DESIGN_REQUIRE((tau) > 0 && (t) > 0 && (t) <= (tau), zoh_needs_t_below_tau), \
+	               (1LL << 30) - DESIGN_EXP_NEG_Q30(t, tau), -DESIGN_EXP_NEG_Q30(t, tau), 1LL << 30, q, lo, hi)
+
+/* ----------------- Lead-lag: H(s) = (ta s + 1) / (tb s + 1) ----------------- */
+
+/**
+ * @brief Lead-lag section with unit DC gain, Tustin.
+ *
+ * ta > tb gives phase lead, ta < tb phase lag.
+ *
+ * @param ta Zero time constant.
+ * @param tb Pole time constant.
+ * @param t Sample time, same unit as ta and tb.
+ * @param q Q-format of the cascade.
+ * @param lo, hi Output limits.
+ */
+#define DESIGN_LEADLAG_TUSTIN(ta, tb, t, q, lo, hi)                                                \
+	DESIGN_SECTION(2 * (int64_t)(ta) + (t) +                                                       \
+	               DESIGN_REQUIRE((ta) >= 0 && (tb) > 0 && (t) > 0, leadlag_times_must_be_positive), \
+	               (int64_t)(t) - 2 * (int64_t)(ta), (int64_t)(t) - 2 * (int64_t)(tb), 2 * (int64_t)(tb) + (t), q, lo, hi)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _CTRLDESIGN_H_
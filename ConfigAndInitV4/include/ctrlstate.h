@@ -0,0 +1,45 @@
+#ifndef _CTRLSTATE_H_
+#define _CTRLSTATE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief One coherent sample of the control loop.
+ */
+typedef struct {
+	uint32_t millisec;   //!< Sample time in milliseconds.
+	int32_t  reference;  //!< Reference used for this sample in RPM.
+	int32_t  velocity;   //!< Measured velocity in RPM.
+	int32_t  control;    //!< Applied control signal (Q30).
+} ctrl_state_t;
+
+/**
+ * @brief Publish a new control-loop sample.
+ *
+ * This function stores a complete sample for the readers. It never blocks and
+ * never disables interrupts. There must be a single writer (app_ctrl).
+ *
+ * @param state Pointer to the sample to publish.
+ */
+void CtrlState_Publish(const ctrl_state_t* state);
+
+/**
+ * @brief Read the latest published control-loop sample.
+ *
+ * This function copies the newest complete sample. It can be called from any
+ * thread or interrupt; a reader preempted by the writer retries, a reader that
+ * preempts the writer gets the previous sample without waiting.
+ *
+ * @param state Pointer to where the sample is copied.
+ * @return The number of samples published so far.
+ */
+uint32_t CtrlState_Read(ctrl_state_t* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _CTRLSTATE_H_
@@ -0,0 +1,273 @@
+#ifndef _FIXEDPOINT_H_
+#define _FIXEDPOINT_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef FIX_ACLE
+#if defined (__ARMCC_VERSION) && (__ARMCC_VERSION >= 6100100) && defined (__ARM_FEATURE_SAT) && defined (__ARM_FEATURE_DSP)
+#define FIX_ACLE 1   //!< Saturation maps onto SSAT and QADD/QSUB (Cortex-M4 DSP extension).
+#else
+#define FIX_ACLE 0   //!< Portable C, bit-exact with the ACLE mapping.
+#endif
+#endif
+
+#if FIX_ACLE && defined (__ARMCC_VERSION)
+#include <arm_acle.h>
+#elif FIX_ACLE
+// The intrinsics as the ACLE defines them, so a host build with -DFIX_ACLE=1
+// runs the target branch (see host/source/fixedpoint_host.c).
+static inline int32_t __ssat(int32_t x, unsigned int n)
+{
+	const int32_t max = (int32_t)((1UL << (n - 1U)) - 1U);
+	return (x > max) ? max : ((x < -max - 1) ? -max - 1 : x);
+}
+
+static inline int32_t __qadd(int32_t a, int32_t b)
+{
+	const int64_t x = (int64_t)a + b;
+	return (x > INT32_MAX) ? INT32_MAX : ((x < INT32_MIN) ? INT32_MIN : (int32_t)x);
+}
+
+static inline int32_t __qsub(int32_t a, int32_t b)
+{
+	const int64_t x = (int64_t)a - b;
+	return (x > INT32_MAX) ? INT32_MAX : ((x < INT32_MIN) ? INT32_MIN : (int32_t)x);
+}
+#endif
+
+#define CTRL_Q   30                      //!< Fractional bits of the control signal.
+#define CTRL_MAX ((int32_t)0x3FFFFFFF)   //!< +100% duty (full clockwise), Q30.
+#define CTRL_MIN ((int32_t)0xC0000000)   //!< -100% duty (full counter-clockwise), Q30.
+#define Q15_ONE  32768                   //!< 1.0 in Q15.
+
+/**
+ * @brief Q15 value in [-1, 1), e.g. a normalised error or a gain.
+ *
+ * The formats are distinct struct types, so passing a Q15 value where a Q30
+ * value is expected does not compile. The raw integer is in .v.
+ */
+typedef struct {
+	int32_t v;   //!< Raw value, [-32768, 32767].
+} q15_t;
+
+/**
+ * @brief Q30 control value in [-1, 1), the full duty range.
+ */
+typedef struct {
+	int32_t v;   //!< Raw value, [CTRL_MIN, CTRL_MAX].
+} q30_t;
+
+#define Q15(raw) ((q15_t){ (int32_t)(raw) })   //!< Tag a raw integer as Q15, no conversion.
+#define Q30(raw) ((q30_t){ (int32_t)(raw) })   //!< Tag a raw integer as Q30, no conversion.
+
+/* ----------------- Raw saturation ----------------- */
+
+/**
+ * @brief Saturate a 32-bit value to the Q15 range (SSAT #16).
+ */
+static inline int32_t Fix_Sat15(int32_t x)
+{
+#if FIX_ACLE
+	return __ssat(x, 16);
+#else
+	if (x > 32767)
+		return 32767;
+	if (x < -32768)
+		return -32768;
+	return x;
+#endif
+}
+
+/**
+ * @brief Saturate a 32-bit value to the control range (SSAT #31).
+ */
+static inline int32_t Fix_Sat30(int32_t x)
+{
+#if FIX_ACLE
+	return __ssat(x, 31);
+#else
+	if (x > CTRL_MAX)
+		return CTRL_MAX;
+	if (x < CTRL_MIN)
+		return CTRL_MIN;
+	return x;
+#endif
+}
+
+/**
+ * @brief Saturate a 64-bit intermediate to the control range.
+ *
+ * Use it for products that are formed in 64 bits to avoid overflow. On the
+ * target one compare of the high word replaces the two 64-bit compares:
+ * values that fit 32 bits go through SSAT.
+ */
+static inline int32_t Fix_Sat30Wide(int64_t x)
+{
+#if FIX_ACLE
+	const int32_t lo = (int32_t)x;
+	if ((int32_t)(x >> 32) != (lo >> 31))
+		return (x < 0) ? CTRL_MIN : CTRL_MAX;
+	return __ssat(lo, 31);
+#else
+	if (x > (int64_t)CTRL_MAX)
+		return CTRL_MAX;
+	if (x < (int64_t)CTRL_MIN)
+		return CTRL_MIN;
+	return (int32_t)x;
+#endif
+}
+
+/**
+ * @brief Saturate a 64-bit intermediate to the Q15 range.
+ */
+static inline int32_t Fix_Sat15Wide(int64_t x)
+{
+#if FIX_ACLE
+	const int32_t lo = (int32_t)x;
+	if ((int32_t)(x >> 32) != (lo >> 31))
+		return (x < 0) ? -32768 : 32767;
+	return __ssat(lo, 16);
+#else
+	if (x > 32767)
+		return 32767;
+	if (x < -32768)
+		return -32768;
+	return (int32_t)x;
+#endif
+}
+
+/**
+ * @brief Add with saturation to the int32 range (QADD).
+ *
+ * Sums of Q30 terms can be chained through it without 64-bit math: the
+ * result keeps the sign and, once out of range, stays out of the control
+ * range, so Fix_Sat30() of it equals the saturated exact sum.
+ */
+static inline int32_t Fix_QAdd(int32_t a, int32_t b)
+{
+#if FIX_ACLE
+	return __qadd(a, b);
+#else
+	const int64_t x = (int64_t)a + b;
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t)x;
+#endif
+}
+
+/**
+ * @brief Subtract with saturation to the int32 range (QSUB).
+ */
+static inline int32_t Fix_QSub(int32_t a, int32_t b)
+{
+#if FIX_ACLE
+	return __qsub(a, b);
+#else
+	const int64_t x = (int64_t)a - b;
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t)x;
+#endif
+}
+
+/**
+ * @brief Clamp to [lo, hi], for bounds that are not a power of two.
+ */
+static inline int32_t Fix_Clamp(int32_t x, int32_t lo, int32_t hi)
+{
+	if (x > hi)
+		return hi;
+	if (x < lo)
+		return lo;
+	return x;
+}
+
+/**
+ * @brief High word of a 32 x 32 product, (a * b) >> 32, rounded down.
+ *
+ * One SMULL (or SMMUL) on the target, no 64-bit shift.
+ */
+static inline int32_t Fix_MulHi(int32_t a, int32_t b)
+{
+	return (int32_t)(((int64_t)a * b) >> 32);
+}
+
+/* ----------------- Typed arithmetic ----------------- */
+
+/**
+ * @brief Saturating Q30 addition.
+ *
+ * Q30 values only use 31 bits, so the 32-bit sum cannot overflow and a
+ * single SSAT saturates it.
+ */
+static inline q30_t Q30_Add(q30_t a, q30_t b)
+{
+	return Q30(Fix_Sat30(a.v + b.v));
+}
+
+/**
+ * @brief Q30 addition with saturation to the int32 range only (QADD).
+ *
+ * For sums that are tested for saturation before they are applied: the raw
+ * result may lie outside the control range, further terms can be added
+ * with Fix_QAdd() and Fix_Sat30() of the total is the saturated exact sum.
+ */
+static inline int32_t Q30_AddWide(q30_t a, q30_t b)
+{
+	return Fix_QAdd(a.v, b.v);
+}
+
+/**
+ * @brief Saturating Q30 subtraction.
+ */
+static inline q30_t Q30_Sub(q30_t a, q30_t b)
+{
+	return Q30(Fix_Sat30(a.v - b.v));
+}
+
+/**
+ * @brief Q15 * Q15 = Q30, saturated.
+ *
+ * The product fits 32 bits (one MUL); only -1 * -1 leaves the range.
+ */
+static inline q30_t Q15_Mul(q15_t a, q15_t b)
+{
+	return Q30(Fix_Sat30(a.v * b.v));
+}
+
+/**
+ * @brief Scale a Q30 value by a Q15 gain, saturated (SMULL).
+ */
+static inline q30_t Q30_MulQ15(q30_t a, q15_t g)
+{
+	return Q30(Fix_Sat30Wide(((int64_t)a.v * g.v) >> 15));
+}
+
+/**
+ * @brief Saturate a 64-bit Q30 intermediate and tag it.
+ */
+static inline q30_t Q30_Sat(int64_t raw)
+{
+	return Q30(Fix_Sat30Wide(raw));
+}
+
+/**
+ * @brief Saturate a 64-bit Q15 intermediate and tag it.
+ */
+static inline q15_t Q15_Sat(int64_t raw)
+{
+	return Q15(Fix_Sat15Wide(raw));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _FIXEDPOINT_H_
@@ -0,0 +1,82 @@
+#ifndef _FREQRESP_H_
+#define _FREQRESP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define FREQRESP_POINTS 10   //!< Number of frequencies in a sweep.
+
+#define FREQRESP_OPEN_LOOP   1   //!< Inject at the controller output, measure L = -u_ctrl / u.
+#define FREQRESP_CLOSED_LOOP 2   //!< Inject at the reference, measure T = velocity / reference.
+
+/**
+ * @brief One measured point of the frequency response.
+ */
+typedef struct {
+	uint32_t freq_mhz;    //!< Excitation frequency in millihertz (exactly on the Goertzel bin).
+	int32_t  gain_q16;    //!< Magnitude of the response (Q16, 65536 = 0 dB).
+	int32_t  phase_cdeg;  //!< Phase of the response in centidegrees (-18000, 18000].
+} freqresp_point_t;
+
+/**
+ * @brief Start a stepped-sine sweep.
+ *
+ * Every frequency is first applied for a settling time and then measured over
+ * a whole number of periods with one Goertzel filter per channel.
+ * It can also be started by setting FREQRESP_REQUEST to the mode in Watch.
+ * Any other mode is ignored and no sweep starts.
+ *
+ * @param mode FREQRESP_OPEN_LOOP or FREQRESP_CLOSED_LOOP.
+ */
+void FreqResp_Start(uint8_t mode);
+
+/**
+ * @brief Check whether a sweep is in progress.
+ *
+ * This function has no side effects and can be called from any thread, e.g. to
+ * hold the reference constant while measuring.
+ *
+ * @return Non-zero while a sweep is running.
+ */
+uint8_t FreqResp_IsActive(void);
+
+/**
+ * @brief Get the reference excitation for this control period.
+ *
+ * This function returns the sine to add to the reference in closed-loop mode,
+ * and zero otherwise. Must be called before Controller_PIController().
+ *
+ * @return The reference excitation in RPM.
+ */
+int32_t FreqResp_Excitation(void);
+
+/**
+ * @brief Run one control period of the sweep.
+ *
+ * This function adds the output excitation in open-loop mode, feeds the two
+ * Goertzel filters and advances the sine. Must be called once per control
+ * period, after Controller_PIController(); when idle it only checks for a
+ * FREQRESP_REQUEST.
+ *
+ * @param control The control signal from the controller (Q30).
+ * @param ref_rpm The reference used for this sample, including excitation, in RPM.
+ * @param meas_rpm The measured velocity in RPM.
+ * @return The control signal including excitation (Q30).
+ */
+int32_t FreqResp_Step(int32_t control, int32_t ref_rpm, int32_t meas_rpm);
+
+/**
+ * @brief Read the result table of the last sweep.
+ *
+ * @param table Pointer to an array of FREQRESP_POINTS points.
+ * @return The number of points measured so far.
+ */
+uint8_t FreqResp_GetTable(freqresp_point_t* table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _FREQRESP_H_
@@ -0,0 +1,92 @@
+#ifndef _HW_H_
+#define _HW_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Register access used by peripherals.c, resolved at compile time.
+ *
+ * On the target every accessor is a static inline load or store of the
+ * CMSIS register, so the generated code is the same as writing TIM3->CCR1
+ * directly. Building with HW_HOST defined (and host/include on the include
+ * path) routes the same accessors to a simulated register file that records
+ * every access with a timestamp, see hw_host.h.
+ */
+
+#if defined (HW_HOST)
+#include "hw_host.h"
+#else
+#include "stm32l4xx.h"
+#endif
+
+#define HW_PA5 (1U << 5)   //!< Half-bridge enable A (PA5).
+#define HW_PA6 (1U << 6)   //!< Half-bridge enable B (PA6).
+
+/**
+ * @brief Read the encoder counter (TIM1_CNT).
+ */
+static inline uint32_t Hw_TIM1_ReadCNT(void)
+{
+#if defined (HW_HOST)
+	return HwHost_Read(HW_TIM1_CNT);
+#else
+	return TIM1->CNT;
+#endif
+}
+
+/**
+ * @brief Read the PWM auto-reload value (TIM3_ARR).
+ */
+static inline uint32_t Hw_TIM3_ReadARR(void)
+{
+#if defined (HW_HOST)
+	return HwHost_Read(HW_TIM3_ARR);
+#else
+	return TIM3->ARR;
+#endif
+}
+
+/**
+ * @brief Write the counter-clockwise PWM compare value (TIM3_CCR1).
+ */
+static inline void Hw_TIM3_WriteCCR1(uint32_t value)
+{
+#if defined (HW_HOST)
+	HwHost_Write(HW_TIM3_CCR1, value);
+#else
+	TIM3->CCR1 = value;
+#endif
+}
+
+/**
+ * @brief Write the clockwise PWM compare value (TIM3_CCR2).
+ */
+static inline void Hw_TIM3_WriteCCR2(uint32_t value)
+{
+#if defined (HW_HOST)
+	HwHost_Write(HW_TIM3_CCR2, value);
+#else
+	TIM3->CCR2 = value;
+#endif
+}
+
+/**
+ * @brief Set (low half) and reset (high half) GPIOA pins atomically (GPIOA_BSRR).
+ */
+static inline void Hw_GPIOA_WriteBSRR(uint32_t value)
+{
+#if defined (HW_HOST)
+	HwHost_Write(HW_GPIOA_BSRR, value);
+#else
+	GPIOA->BSRR = value;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _HW_H_
@@ -0,0 +1,52 @@
+#ifndef _ILC_H_
+#define _ILC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "application.h"
+
+#define ILC_LEN (PERIOD_REF / PERIOD_CTRL)   //!< Correction table entries, one per control sample of a reference half-period.
+
+/**
+ * @brief Add the learned feedforward correction to the control signal.
+ *
+ * This function adds the correction for the current position in the reference
+ * cycle to the control signal and refines the table entry of the previous sample
+ * with the measured tracking error. The cycle restarts whenever the sign of the
+ * reference changes, and both half-periods share the table with opposite sign.
+ * Must be called once per control period, after Controller_PIController().
+ *
+ * @param control The control signal from the controller (Q30).
+ * @param ref_rpm The reference used for this sample in RPM.
+ * @param meas_rpm The measured velocity in RPM.
+ * @return The corrected, saturated control signal (Q30).
+ */
+int32_t Ilc_Step(int32_t control, int32_t ref_rpm, int32_t meas_rpm);
+
+/**
+ * @brief Freeze or release the learning.
+ *
+ * While frozen, the correction is still applied and follows the reference
+ * cycle, but the table is not updated. Use it whenever the loop is excited on
+ * purpose (identification, sweeps), like Controller_FreezeAdaptation().
+ *
+ * @param freeze Non-zero to freeze, zero to release.
+ */
+void Ilc_FreezeLearning(uint8_t freeze);
+
+/**
+ * @brief Forget the learned correction.
+ *
+ * This function clears the correction table and waits for the next reference
+ * sign change before learning again.
+ * It doesn't take any arguments and doesn't return any value.
+ */
+void Ilc_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _ILC_H_
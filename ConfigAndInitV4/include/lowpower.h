@@ -0,0 +1,37 @@
+#ifndef _LOWPOWER_H_
+#define _LOWPOWER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define LOWPOWER_GUARD_TICKS 1   //!< Kernel ticks kept awake before the next timer event, absorbs wake-up latency.
+#define LOWPOWER_MIN_TICKS   2   //!< Shortest idle period (in kernel ticks) worth entering STOP2 for.
+
+/**
+ * @brief Initialize the low-power timer used for tickless idle.
+ *
+ * This function starts the LSE oscillator, clocks LPTIM1 from it and enables
+ * the LPTIM1 wake-up line, so that the RTX idle thread can enter STOP2 between
+ * control periods. It must be called before osKernelStart().
+ * It doesn't take any arguments and doesn't return any value.
+ */
+void LowPower_Init(void);
+
+/**
+ * @brief Get the number of kernel ticks spent in STOP2 since start-up.
+ *
+ * This function returns the accumulated amount of kernel ticks that the idle
+ * thread has slept in STOP2. Together with osKernelGetTickCount() it gives
+ * the fraction of time the MCU spent in low-power mode.
+ *
+ * @return The number of kernel ticks slept in STOP2.
+ */
+uint32_t LowPower_GetSleptTicks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _LOWPOWER_H_
@@ -0,0 +1,80 @@
+#ifndef _MICROBENCH_H_
+#define _MICROBENCH_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#if !defined (HW_HOST)
+#include "stm32l4xx.h"
+#endif
+
+#define MICROBENCH_N 256   //!< Timed calls per case.
+
+/**
+ * @brief The hot-path functions that are timed.
+ */
+typedef enum {
+	MB_PI_CONTROLLER,     //!< Controller_PIController() on tracking errors around a +/-2000 RPM reference.
+	MB_ENCODER_VELOCITY,  //!< Peripheral_Encoder_CountsToRPM() on counter steps up to +/-6000 RPM.
+	MB_CONTROL_TO_COUNTS, //!< Peripheral_PWM_ControlToCounts() over the full int32 range.
+	MB_PWM_ACTUATE,       //!< Peripheral_PWM_ActuateMotor() over the full int32 range, motor disabled.
+	MB_CASE_COUNT
+} mb_case_t;
+
+/**
+ * @brief Cycle statistics of one case, net of the timing overhead.
+ */
+typedef struct {
+	uint32_t min;      //!< Fastest call.
+	uint32_t median;   //!< Typical call.
+	uint32_t max;      //!< Slowest call.
+} mb_result_t;
+
+/**
+ * @brief Read the cycle counter.
+ *
+ * The DWT cycle counter on the target. On the host the time stamp counter
+ * (x86) or the monotonic clock in ns, see microbench_host.c.
+ */
+#if defined (HW_HOST)
+uint32_t Microbench_Cycles(void);
+#else
+static inline uint32_t Microbench_Cycles(void)
+{
+	return DWT->CYCCNT;
+}
+#endif
+
+/**
+ * @brief Time one case.
+ *
+ * Calls the function MICROBENCH_N times on a fixed pseudo-random input
+ * sequence, preparing each input outside the timed window. Writes the PWM
+ * registers and resets the controller, including its learned feedforward,
+ * so run it before the control loop starts. The encoder is not touched.
+ * The motor is disabled throughout.
+ *
+ * @param c The case to time.
+ * @param result Pointer to where the statistics are written.
+ */
+void Microbench_Run(mb_case_t c, mb_result_t* result);
+
+/**
+ * @brief Time all cases.
+ *
+ * @param results Array of MB_CASE_COUNT results, indexed by mb_case_t.
+ */
+void Microbench_RunAll(mb_result_t* results);
+
+/**
+ * @brief Name of a case for printing, e.g. "Controller_PIController".
+ */
+const char* Microbench_Name(mb_case_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _MICROBENCH_H_
@@ -40,6 +40,19 @@ void Peripheral_GPIO_DisableMotor(void);
  */
 void Peripheral_PWM_ActuateMotor(int32_t control);
 
+/**
+ * @brief Convert a control signal to signed PWM timer counts.
+ *
+ * The control signal is saturated to the Q30 range first. The result is
+ * in [-(top - 1), top - 1], its sign selects the direction.
+ * Peripheral_PWM_ActuateMotor() uses it; it is exported for benchmarking.
+ *
+ * @param control The control signal (Q30).
+ * @param top The timer period in counts (ARR + 1), below 2^29.
+ * @return The duty cycle in timer counts.
+ */
+int32_t Peripheral_PWM_ControlToCounts(int32_t control, uint32_t top);
+
 /**
  * @brief Read the encoder value and calculate the current velocity in RPM.
  *
@@ -69,6 +82,32 @@ void Peripheral_PWM_ActuateMotor(int32_t control);
  */
 int32_t Peripheral_Encoder_CalculateVelocity(uint32_t millisec);
 
+/**
+ * @brief Convert an encoder counter difference to a velocity.
+ *
+ * The arithmetic of Peripheral_Encoder_CalculateVelocity() without the
+ * register read and its state, e.g. for timing it on made-up inputs.
+ *
+ * @param counts Signed counter difference.
+ * @param millisec Time between the two readings in milliseconds, not zero.
+ * @return The velocity in RPM.
+ */
+int32_t Peripheral_Encoder_CountsToRPM(int16_t counts, uint32_t millisec);
+
+/**
+ * @brief Read the encoder and return the extended position in counts.
+ *
+ * This function extends the 16-bit encoder counter to a 32-bit position
+ * (2048 counts per revolution). The first call returns zero. It must be called
+ * at least once per 32768 counts (every 160 ms at 6000 RPM) to follow the
+ * counter across wrap-around.
+ *
+ * This function must be READ ONLY on the encoder register!
+ *
+ * @return The motor position in encoder counts.
+ */
+int32_t Peripheral_Encoder_GetPosition(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,71 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ctrlstate.h"
+#include "controller.h"
+#include "fixedpoint.h"
+
+/**
+ * @brief Define a control pipeline from four policies, composed at compile time.
+ *
+ * Every policy is the name of a function (or function-like macro) that is
+ * called directly, so the step inlines into straight-line code without
+ * function pointers. Swapping an estimator or law is a change of one name.
+ *   int32_t estimator(uint32_t millisec);                                 // Velocity in RPM
+ *   int32_t law(int32_t reference, int32_t velocity, uint32_t millisec);  // Control signal (Q30)
+ *   int32_t limiter(int32_t control);                                     // Bounded control signal (Q30)
+ *   void    actuator(int32_t control);
+ * Expands to a static inline function that fills in velocity and control of
+ * a sample whose millisec and reference are set:
+ *   void name##_step(ctrl_state_t* s);
+ * Use it at file scope in a C source file.
+ *
+ * @param name Prefix of the generated step function.
+ * @param estimator Velocity estimator policy.
+ * @param law Control law policy.
+ * @param limiter Output limiter policy.
+ * @param actuator Actuator policy.
+ */
+#define PIPELINE_DEFINE(name, estimator, law, limiter, actuator)                  \
+	static inline void name##_step(ctrl_state_t* s)                               \
+	{                                                                             \
+		s->velocity = estimator(s->millisec);                                     \
+		s->control  = limiter(law(s->reference, s->velocity, s->millisec));       \
+		actuator(s->control);                                                     \
+	}
+
+/* ----------------- Stock policies ----------------- */
+
+/**
+ * @brief Law policy: the controller selected by CONTROLLER_LAW.
+ */
+static inline int32_t Pipeline_Controller(int32_t reference, int32_t velocity, uint32_t millisec)
+{
+	return Controller_PIController(&reference, &velocity, &millisec);
+}
+
+/**
+ * @brief Limiter policy: saturate to the control range (SSAT).
+ */
+static inline int32_t Pipeline_LimitCtrl(int32_t control)
+{
+	return Fix_Sat30(control);
+}
+
+/**
+ * @brief Limiter policy: pass through, for laws that already saturate.
+ */
+static inline int32_t Pipeline_NoLimit(int32_t control)
+{
+	return control;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _PIPELINE_H_
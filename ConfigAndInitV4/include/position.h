@@ -0,0 +1,73 @@
+#ifndef _POSITION_H_
+#define _POSITION_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define POSITION_COUNTS_PER_REV 2048   //!< Encoder counts per revolution, must match peripherals.c.
+#define POSITION_DIVIDER        2      //!< The outer loop runs every POSITION_DIVIDER control periods.
+
+/**
+ * @brief Move to an absolute position and hold it there.
+ *
+ * This function switches the control loop to position mode. A profile with
+ * limited velocity and acceleration moves the position setpoint to the target,
+ * and an outer P/PI loop on the encoder position turns it into the velocity
+ * reference of the PI controller. The command is applied at the next control
+ * period. It can also be given by setting POSITION_REQUEST to 1 in Watch.
+ *
+ * @param target_counts The target position in encoder counts.
+ * @param vmax_rpm The velocity limit of the move in RPM.
+ * @param accel_rpm_s The acceleration limit of the move in RPM per second.
+ */
+void Position_MoveTo(int32_t target_counts, int32_t vmax_rpm, int32_t accel_rpm_s);
+
+/**
+ * @brief Leave position mode.
+ *
+ * The velocity reference from the trajectory generator is used again from
+ * the next control period. app_ctrl seeds the generator with the position
+ * loop's reference every period (Trajectory_Seed()), so the profile continues
+ * from it without a step. It can also be given by setting POSITION_REQUEST to 2 in Watch.
+ * It doesn't take any arguments and doesn't return any value.
+ */
+void Position_Release(void);
+
+/**
+ * @brief Check whether position mode is active.
+ *
+ * This function has no side effects and can be called from any thread.
+ *
+ * @return Non-zero while in position mode.
+ */
+uint8_t Position_IsActive(void);
+
+/**
+ * @brief Check whether the last move has finished.
+ *
+ * @return Non-zero when the profile has reached the target and the position error is within tolerance.
+ */
+uint8_t Position_InTarget(void);
+
+/**
+ * @brief Run one control period of position mode.
+ *
+ * This function must be called every control period with the extended encoder
+ * position. The outer loop is evaluated every POSITION_DIVIDER calls and its
+ * output is held in between. In velocity mode it only checks for commands and
+ * leaves the reference untouched.
+ *
+ * @param pos_counts The measured position in encoder counts.
+ * @param ref_rpm Pointer to the velocity reference, overwritten in position mode.
+ * @param dref_rpm_s Pointer to the reference derivative, overwritten in position mode.
+ * @return Non-zero if the reference was overwritten.
+ */
+uint8_t Position_Step(int32_t pos_counts, int32_t* ref_rpm, int32_t* dref_rpm_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _POSITION_H_
@@ -0,0 +1,41 @@
+#ifndef _SRAM2_H_
+#define _SRAM2_H_
+
+/*
+ * Placement of the control path in SRAM2.
+ *
+ * At 80 MHz the flash needs four wait states, so every ART cache miss on the
+ * control path costs a refill. SRAM2 at 0x10000000 is reached over the
+ * ICode/DCode buses without wait states. With CTRL_IN_SRAM2 set, code,
+ * constants and variables between SRAM2_BEGIN and SRAM2_END go to the
+ * .sram2_* sections, which sram2.sct places in the execution region
+ * ER_SRAM2. The C library's scatter loading (__main) copies the code,
+ * constants and initialised data there from flash and zeroes the rest
+ * before main() runs, so no start-up code changes are needed.
+ *
+ * Link with sram2.sct (Options for Target > Linker > Scatter File, with
+ * "Use Memory Layout from Target Dialog" unticked). With the default layout
+ * the sections silently stay in flash; the map file lists ER_SRAM2 when the
+ * placement took effect. Library helpers (e.g. __aeabi_ldivmod) stay in flash.
+ *
+ * Measure with CTRL_BENCH (cycles and worst case of every controller step)
+ * and MICROBENCH (per function), once with CTRL_IN_SRAM2 0 and once with 1.
+ */
+
+#ifndef CTRL_IN_SRAM2
+#define CTRL_IN_SRAM2 0   //!< 1 = run the control path from SRAM2, set in the build to switch (needs sram2.sct).
+#endif
+
+#if CTRL_IN_SRAM2 && !defined (__ARMCC_VERSION)
+#error "CTRL_IN_SRAM2 needs Arm Compiler 6 (#pragma clang section) and the sram2.sct scatter file"
+#endif
+
+#if CTRL_IN_SRAM2
+#define SRAM2_BEGIN _Pragma("clang section text=\".sram2_text\" rodata=\".sram2_rodata\" data=\".sram2_data\" bss=\".sram2_bss\"")   //!< Start placing code and data in SRAM2.
+#define SRAM2_END   _Pragma("clang section text=\"\" rodata=\"\" data=\"\" bss=\"\"")                                                //!< Back to the default sections.
+#else
+#define SRAM2_BEGIN
+#define SRAM2_END
+#endif
+
+#endif   // _SRAM2_H_
@@ -0,0 +1,69 @@
+#ifndef _SYSID_H_
+#define _SYSID_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Identified first-order motor model and derived settings.
+ *
+ * Model: v[k] = a * v[k-1] + b * u[k-1] + c * sign(v[k-1])
+ */
+typedef struct {
+	uint8_t  status;     //!< 0 = never run, 1 = running, 2 = done and applied, 3 = rejected (model not plausible).
+	int32_t  a;          //!< Pole (Q24).
+	int32_t  b;          //!< Input gain on normalised signals (Q24).
+	int32_t  c;          //!< Friction term on normalised signals (Q24).
+	uint32_t tau_ms;     //!< Mechanical time constant in milliseconds.
+	int32_t  u_per_rpm;  //!< Steady-state control per RPM (Q30 per RPM), fed to ctrl_params_t.
+	int32_t  u_fric;     //!< Control needed to overcome Coulomb friction (Q30).
+	int32_t  kp;         //!< Proportional gain (Q15) from the model.
+	int32_t  ki;         //!< Integral gain per second (Q15) from the model.
+} sysid_result_t;
+
+/**
+ * @brief Start an identification run.
+ *
+ * A pseudo-random binary sequence is added to the control output for
+ * SYSID_SAMPLES control periods while a recursive least squares estimator
+ * fits the model. It can also be started by setting SYSID_REQUEST to 1 in Watch.
+ * It doesn't take any arguments and doesn't return any value.
+ */
+void Sysid_Start(void);
+
+/**
+ * @brief Check whether an identification run is in progress.
+ *
+ * @return Non-zero while the run is active.
+ */
+uint8_t Sysid_IsActive(void);
+
+/**
+ * @brief Run one control period of the identification.
+ *
+ * This function updates the estimator with the previous input and the new
+ * measurement, then adds the next excitation bit to the control signal. When
+ * the run ends, a plausible model is applied with Controller_SetParams(),
+ * including the time constant of an enabled disturbance observer.
+ * Must be called once per control period, after the controller.
+ *
+ * @param control The control signal from the controller (Q30).
+ * @param meas_rpm The measured velocity in RPM.
+ * @return The control signal including excitation (Q30).
+ */
+int32_t Sysid_Step(int32_t control, int32_t meas_rpm);
+
+/**
+ * @brief Read the result of the last identification run.
+ *
+ * @param result Pointer to where the result is copied.
+ */
+void Sysid_GetResult(sysid_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _SYSID_H_
@@ -0,0 +1,121 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "controller.h"
+#include <stdint.h>
+
+/*
+ * Capture format of the controller's inputs and outputs.
+ *
+ * A log is a telemetry_header_t followed by telemetry_record_t records, one
+ * per control sample, little-endian as on the target. A stream log
+ * (capacity 0) holds the records in order. A ring image (capacity N) is a
+ * dump of TELEMETRY_LOG: the newest min(count, N) records, the oldest at
+ * index count % N once the ring has wrapped.
+ *
+ * A record holds everything Controller_PIController() depends on, so the
+ * host tool host/source/replay_host.c can step the controller through a log
+ * bit-exactly and report where its output differs from the recorded one.
+ * The replay starts from the parameters in the header; it is exact from the
+ * first record of a capture (seq 0), as Controller_Reset() clears the learned
+ * feedforward, while a wrapped ring starts with the learned feedforward of an
+ * unknown earlier state.
+ */
+
+#define TELEMETRY_MAGIC   0x4C54464DU   //!< "MFTL" at the start of a log.
+#define TELEMETRY_VERSION 1U            //!< Format version, changes with the layout of the structures below.
+
+#ifndef TELEMETRY_N
+#define TELEMETRY_N 256U   //!< Records in the ring buffer (power of two), 2.56 s at PERIOD_CTRL 10 ms.
+#endif
+
+#define TELEMETRY_F_RESET  0x01U   //!< The controller was restarted before this sample (capture start, relay experiment).
+#define TELEMETRY_F_NOLAW  0x02U   //!< Controller_PIController() did not run, 'law' is 0.
+#define TELEMETRY_F_FROZEN 0x04U   //!< The feedforward adaptation was frozen.
+#define TELEMETRY_F_PARAMS 0x08U   //!< The controller switched to parameters that are not in the log.
+
+/**
+ * @brief Start of a log.
+ */
+typedef struct {
+	uint32_t magic;          //!< TELEMETRY_MAGIC.
+	uint16_t version;        //!< TELEMETRY_VERSION.
+	uint16_t record_size;    //!< sizeof (telemetry_record_t).
+	uint32_t period_ms;      //!< Control period (PERIOD_CTRL).
+	uint32_t law;            //!< CONTROLLER_LAW of the build that recorded the log.
+	uint32_t capacity;       //!< Records in the ring, 0 for a stream log.
+	uint32_t count;          //!< Records written since the capture start.
+	uint32_t param_version;  //!< Controller_GetParams() version of 'params'.
+	ctrl_params_t params;    //!< Controller parameters at the capture start.
+} telemetry_header_t;
+
+/**
+ * @brief One control sample.
+ */
+typedef struct {
+	uint32_t seq;        //!< Sample number since the capture start.
+	uint32_t millisec;   //!< Sample time in milliseconds.
+	int32_t  reference;  //!< Reference given to the controller in RPM.
+	int32_t  velocity;   //!< Measured velocity in RPM.
+	int32_t  ref_rate;   //!< Reference derivative given to Controller_SetReferenceRate() in RPM/s.
+	int32_t  law;        //!< Output of Controller_PIController() (Q30).
+	int32_t  control;    //!< Control signal applied to the motor (Q30), after ILC, identification and sweep.
+	uint32_t flags;      //!< TELEMETRY_F_* bits.
+} telemetry_record_t;
+
+/**
+ * @brief Ring buffer on the target, its memory is a ring image log.
+ */
+typedef struct {
+	telemetry_header_t header;
+	telemetry_record_t records[TELEMETRY_N];
+} telemetry_log_t;
+
+/**
+ * @brief Start a new capture.
+ *
+ * Empties the ring and stores the current controller parameters in the
+ * header. Call it right after Controller_Reset(); the first record is
+ * marked TELEMETRY_F_RESET. The learned feedforward and friction are not in
+ * the header, the reset clears them so the replay starts from the same state.
+ */
+void Telemetry_Start(void);
+
+/**
+ * @brief Append one control sample.
+ *
+ * Fills in 'seq', adds TELEMETRY_F_RESET for the first sample and
+ * TELEMETRY_F_PARAMS when the parameter version changed. Overwrites the
+ * oldest record when the ring is full. There must be a single writer
+ * (app_ctrl).
+ *
+ * @param rec Pointer to the sample, 'seq' is ignored.
+ */
+void Telemetry_Record(const telemetry_record_t* rec);
+
+/**
+ * @brief Read one record from the ring.
+ *
+ * Can be called from any thread or from the host while the writer runs.
+ *
+ * @param seq Sample number to read.
+ * @param rec Pointer to where the record is copied.
+ * @return 1 if copied, 0 if not yet written or already overwritten.
+ */
+uint8_t Telemetry_Get(uint32_t seq, telemetry_record_t* rec);
+
+/**
+ * @brief Copy the header of the current capture.
+ *
+ * @param header Pointer to where the header is copied.
+ */
+void Telemetry_GetHeader(telemetry_header_t* header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _TELEMETRY_H_
@@ -0,0 +1,100 @@
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define TRAJ_SCURVE_SHIFT 3   //!< S-curve jerk phase is 2^TRAJ_SCURVE_SHIFT control periods long.
+
+/**
+ * @brief One point of a table-driven profile.
+ */
+typedef struct {
+	int16_t  rpm;  //!< Reference value at the end of the segment in RPM.
+	uint16_t ms;   //!< Time to move linearly from the previous point to this one in milliseconds.
+} traj_point_t;
+
+/**
+ * @brief Move to a new reference with limited acceleration (trapezoidal profile).
+ *
+ * @param target_rpm The reference to reach in RPM.
+ * @param accel_rpm_s The slope of the ramp in RPM per second.
+ */
+void Trajectory_Ramp(int32_t target_rpm, int32_t accel_rpm_s);
+
+/**
+ * @brief Move to a new reference with limited acceleration and jerk (S-curve profile).
+ *
+ * The ramp is smoothed by a moving average over 2^TRAJ_SCURVE_SHIFT control periods,
+ * which limits the jerk to accel_rpm_s divided by that time.
+ *
+ * @param target_rpm The reference to reach in RPM.
+ * @param accel_rpm_s The maximum slope in RPM per second.
+ */
+void Trajectory_SCurve(int32_t target_rpm, int32_t accel_rpm_s);
+
+/**
+ * @brief Generate a sine reference.
+ *
+ * @param offset_rpm The centre value in RPM.
+ * @param amp_rpm The amplitude in RPM.
+ * @param freq_mhz The frequency in millihertz.
+ */
+void Trajectory_Sine(int32_t offset_rpm, int32_t amp_rpm, uint32_t freq_mhz);
+
+/**
+ * @brief Generate a linear chirp, sweeping the frequency from f0 to f1.
+ *
+ * After duration_ms the frequency stays at f1.
+ *
+ * @param offset_rpm The centre value in RPM.
+ * @param amp_rpm The amplitude in RPM.
+ * @param f0_mhz The start frequency in millihertz.
+ * @param f1_mhz The end frequency in millihertz.
+ * @param duration_ms The sweep time in milliseconds.
+ */
+void Trajectory_Chirp(int32_t offset_rpm, int32_t amp_rpm, uint32_t f0_mhz, uint32_t f1_mhz, uint32_t duration_ms);
+
+/**
+ * @brief Follow a table of points with linear interpolation.
+ *
+ * The table is read in place and must stay valid while it is in use.
+ *
+ * @param table Pointer to the first point.
+ * @param length Number of points.
+ * @param loop Non-zero to restart from the first point after the last one.
+ */
+void Trajectory_Table(const traj_point_t* table, uint16_t length, uint8_t loop);
+
+/**
+ * @brief Continue the active profile from a reference supplied elsewhere.
+ *
+ * Sets the output to ref_rpm, so the next Trajectory_Step() starts from it
+ * without a step. Ramp, S-curve and table profiles go on towards their
+ * target from there (the S-curve with a full jerk phase); sine and chirp are
+ * fixed in time and return to their curve. Must be called by the control
+ * thread, e.g. every period while another loop replaces the reference.
+ *
+ * @param ref_rpm The reference in RPM that was applied instead.
+ */
+void Trajectory_Seed(int32_t ref_rpm);
+
+/**
+ * @brief Advance the active profile by one control period.
+ *
+ * This function must be called once every PERIOD_CTRL by the control thread.
+ * Profiles requested by other threads are picked up here, so they always
+ * start on a sample boundary.
+ *
+ * @param ref_rpm Pointer to where the reference in RPM is written.
+ * @param dref_rpm_s Pointer to where the reference derivative in RPM per second is written.
+ */
+void Trajectory_Step(int32_t* ref_rpm, int32_t* dref_rpm_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _TRAJECTORY_H_
@@ -11,20 +11,61 @@
 #include "application.h" 
 #include "controller.h"
 #include "peripherals.h"
+#include "lowpower.h"
+#include "ctrlstate.h"
+#include "trajectory.h"
+#include "ilc.h"
+#include "autotune.h"
+#include "sysid.h"
+#include "freqresp.h"
+#include "position.h"
+#include "pipeline.h"
+#include "microbench.h"
+#include "telemetry.h"
+#include "sram2.h"
 #include "cmsis_os2.h"
 
 /* Global variables ----------------------------------------------------------*/
 
-static int32_t reference, velocity;
 static osThreadId_t main_id, ctrl_id, ref_id; //< Defines thread IDs
 static osTimerId_t ctrl_timer, ref_timer;     //< Defines callback timers
 
+#if CTRL_BENCH
+// Controller benchmark (read in Watch, write CTRL_BENCH_N = 0 to restart).
+// Average cycles = CTRL_CYCLES_SUM / CTRL_BENCH_N, mean |error| = CTRL_ERR_ABS_SUM / CTRL_BENCH_N (RPM).
+volatile uint32_t CTRL_CYCLES_LAST = 0; //< Cycles of the last Controller_PIController() call
+volatile uint32_t CTRL_CYCLES_MAX  = 0; //< Worst case since the restart
+volatile uint32_t CTRL_CYCLES_SUM  = 0;
+volatile uint32_t CTRL_ERR_ABS_SUM = 0;
+volatile uint32_t CTRL_BENCH_N     = 0;
+#endif
+
+#if MICROBENCH
+// Cycles of each hot-path function in isolation (read in Watch), indexed by mb_case_t.
+mb_result_t MICROBENCH_RESULTS[MB_CASE_COUNT];
+#endif
+
+#if STACK_WATERMARK
+// Unused stack of each thread in bytes (read in Watch), from the RTX watermark, updated every PERIOD_REF.
+volatile uint32_t STACK_FREE_MAIN = 0;
+volatile uint32_t STACK_FREE_CTRL = 0;
+volatile uint32_t STACK_FREE_REF  = 0;
+#endif
+
+#if TELEMETRY
+static telemetry_record_t tlm; //< Sample being captured, law and flags from app_law, the rest from app_ctrl
+#endif
+
 /* Function/Thread declaration -----------------------------------------------*/
 
 static void timerCallback(void *arg); // Callback timer function
 static void init_virtualTimers(void);
 
 static void init_threads(void);
+#if CTRL_BENCH
+static void bench_init(void);
+static void bench_record(uint32_t cycles, int32_t error_rpm);
+#endif
 static void app_main(void *arg);
 static void app_ctrl(void *arg);
 static void app_ref(void *arg);
@@ -43,7 +84,7 @@ static const osThreadAttr_t threadAttr_main = {
  */
 static const osThreadAttr_t threadAttr_ctrl = {
 	.name       = "app_ctrl",
-	.stack_size = 128*4,       // ~24 bytes local variables, ~32 bytes RTOS-functions, ~232 bytes function calls, call-stack + safety ~100 bytes
+	.stack_size = 256*4,       // ~330-480 bytes measured (STACK_WATERMARK, rtos_host with autotune, sysid, sweep and position), ~200 bytes FPU exception frame + RTX context, margin => 1024 bytes
 	.priority   = osPriorityHigh
 };
 
@@ -52,7 +93,7 @@ static const osThreadAttr_t threadAttr_ctrl = {
  */
 static const osThreadAttr_t threadAttr_ref = {
 	.name       = "app_ref",
-	.stack_size = 128*2,              // ~8 bytes local variables, ~100-150 bytes RTOS-function, call-stack + safety ~100 bytes
+	.stack_size = 128*4,              // ~110-190 bytes measured (STACK_WATERMARK, rtos_host), ~200 bytes FPU exception frame + RTX context, margin => 512 bytes
 	.priority   = osPriorityBelowNormal
 };
 
@@ -63,16 +104,30 @@ static const osThreadAttr_t threadAttr_ref = {
  */
 void Application_Setup()
 {
-  // Reset global variables
-  reference = 2000;
-  velocity  = 0;
+  // Reset shared state, soft start towards the first reference
+  CtrlState_Publish(&(ctrl_state_t){ 0 });                // Zeroed sample for early readers
+  Trajectory_SCurve(REF_AMPLITUDE_RPM, REF_ACCEL_RPM_S);
 	
+#if MICROBENCH
+  Microbench_RunAll(MICROBENCH_RESULTS); // Motor still disabled, state is reset below
+#endif
   Peripheral_GPIO_EnableMotor(); // Initialise hardware
+#if CTRL_BENCH
+  bench_init();                  // Start the cycle counter
+#endif
   Controller_Reset();            // Initialize controller	
+  Ilc_Reset();                   // Start learning from an empty correction table
+#if TELEMETRY
+  Telemetry_Start();             // Capture from the controller restart, with the parameters just applied
+#endif
+#if AUTOTUNE_AT_SETUP
+  Autotune_Start();              // Relay experiment before normal operation
+#endif
 	
 	osKernelInitialize();
 	init_threads();                // Initializes threads
 	init_virtualTimers();			  	 // Initializes and starts virtual timers
+	LowPower_Init();               // Tickless idle, STOP2 between control periods
 	osKernelStart();
 }
 
@@ -112,6 +167,40 @@ static void timerCallback(void *arg)
   osThreadFlagsSet((osThreadId_t)arg, 0x01);					// Flags the correct thread through thread ID
 }
  
+#if CTRL_BENCH
+/**
+ * Enables the DWT cycle counter (core clock, stops while in STOP2).
+ */
+static void bench_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Accumulates one controller step into the benchmark counters.
+ *
+ * @param cycles - CPU cycles of the step
+ * @param error_rpm - Reference minus measured velocity of the step
+ */
+static void bench_record(uint32_t cycles, int32_t error_rpm)
+{
+	if (CTRL_BENCH_N == 0)
+	{
+		CTRL_CYCLES_MAX  = 0;
+		CTRL_CYCLES_SUM  = 0;
+		CTRL_ERR_ABS_SUM = 0;
+	}
+	CTRL_CYCLES_LAST = cycles;
+	if (cycles > CTRL_CYCLES_MAX)
+		CTRL_CYCLES_MAX = cycles;
+	CTRL_CYCLES_SUM  += cycles;
+	CTRL_ERR_ABS_SUM += (uint32_t)((error_rpm < 0) ? -error_rpm : error_rpm);
+	CTRL_BENCH_N++;
+}
+#endif
+
 /* Thread Functions ----------------------------------------------------------*/
 
 /**
@@ -186,6 +275,63 @@ __NO_RETURN static void app_ref(void *arg)
 }
 */
 
+/* Control Pipeline ----------------------------------------------------------*/
+
+SRAM2_BEGIN // The control thread and its pipeline run from SRAM2 when CTRL_IN_SRAM2 is set
+
+/**
+ * Control law policy: the controller plus the stages that add to its output.
+ *
+ * @param reference - Reference in RPM
+ * @param velocity - Measured velocity in RPM
+ * @param millisec - Sample time in milliseconds
+ * @return Control signal (Q30)
+ */
+static inline int32_t app_law(int32_t reference, int32_t velocity, uint32_t millisec)
+{
+	if (Autotune_IsActive())
+	{
+#if TELEMETRY
+		tlm.law   = 0;
+		tlm.flags = TELEMETRY_F_NOLAW | TELEMETRY_F_RESET; // The experiment restarts the controller when it ends
+#endif
+		return Autotune_Step(velocity, millisec); // Relay experiment owns the motor
+	}
+	
+	const uint8_t freeze = Sysid_IsActive() || FreqResp_IsActive();
+	Controller_FreezeAdaptation(freeze);                                   // Don't learn from injected excitation
+	Ilc_FreezeLearning(freeze);
+#if CTRL_BENCH
+	const uint32_t t0 = DWT->CYCCNT;
+#endif
+	int32_t control = Pipeline_Controller(reference, velocity, millisec);  // Calculate control signal
+#if CTRL_BENCH
+	bench_record(DWT->CYCCNT - t0, reference - velocity);
+#endif
+#if TELEMETRY
+	tlm.law   = control;
+	tlm.flags = freeze ? TELEMETRY_F_FROZEN : 0U;
+#endif
+	if (!Position_IsActive())
+		control = Ilc_Step(control, reference, velocity);                   // Add learned correction (periodic reference only)
+	if (Sysid_IsActive())
+		control = Sysid_Step(control, velocity);                            // Add identification excitation
+	return FreqResp_Step(control, reference, velocity);                    // Frequency response sweep
+}
+
+/**
+ * Actuator policy: reports the applied signal to the observer and drives the motor.
+ *
+ * @param control - Control signal (Q30)
+ */
+static inline void app_actuate(int32_t control)
+{
+	Controller_SetAppliedControl(control); // Observer input, including the added stages
+	Peripheral_PWM_ActuateMotor(control);  // Apply control signal to motor
+}
+
+PIPELINE_DEFINE(ctrl_pipeline, Peripheral_Encoder_CalculateVelocity, app_law, Pipeline_NoLimit, app_actuate)
+
 /* Thread Functions with Flags -----------------------------------------------*/
 
 /**
@@ -199,25 +345,54 @@ __NO_RETURN static void app_ctrl(void *arg)
 	{
 		osThreadFlagsWait(0x01, osFlagsWaitAny, osWaitForever); // Wait for next sample flagging (flag gets rinsed automatically)
 		
-		uint32_t millisec = Main_GetTickMillisec();
+		ctrl_state_t state;
+		state.millisec  = Main_GetTickMillisec();
 		
-		velocity = Peripheral_Encoder_CalculateVelocity(millisec);            // Calculate motor velocity
-		int32_t control  = Controller_PIController(&reference, &velocity, &millisec); // Calculate control signal
+		int32_t ref_rate;
+		Trajectory_Step(&state.reference, &ref_rate); // Advance reference profile
+		if (Position_Step(Peripheral_Encoder_GetPosition(), &state.reference, &ref_rate)) // Outer loop replaces it in position mode
+			Trajectory_Seed(state.reference);         // On release the profile continues from it, no step
+		Controller_SetReferenceRate(ref_rate);         // Derivative for feedforward
+		state.reference += FreqResp_Excitation();      // Sine on the reference, closed-loop sweep only
 		
-		Peripheral_PWM_ActuateMotor(control); // Apply control signal to motor
+		ctrl_pipeline_step(&state);                    // Estimate, control, limit, actuate
+		
+		CtrlState_Publish(&state);                     // Coherent snapshot for other readers
+#if TELEMETRY
+		tlm.millisec  = state.millisec;
+		tlm.reference = state.reference;
+		tlm.velocity  = state.velocity;
+		tlm.ref_rate  = ref_rate;
+		tlm.control   = state.control;
+		Telemetry_Record(&tlm);                        // Everything the controller saw, for host replay
+#endif
 	}
 }
 
 /**
  * Toggles the direction of the reference every 4000 ms using osThreadFlagsWait().
+ * The reversal itself is an S-curve generated by app_ctrl, not an instantaneous step.
  *
  * @param arg - Thread argument
  */
 __NO_RETURN static void app_ref(void *arg)
 {
+	int32_t target = REF_AMPLITUDE_RPM;
+	
 	for(;;)
 	{
 		osThreadFlagsWait(0x01, osFlagsWaitAny, osWaitForever); // Wait for next sample flagging (flag gets rinsed automatically)
-		reference = -reference;                                 // Flip reference
+#if STACK_WATERMARK
+		STACK_FREE_MAIN = osThreadGetStackSpace(main_id);
+		STACK_FREE_CTRL = osThreadGetStackSpace(ctrl_id);
+		STACK_FREE_REF  = osThreadGetStackSpace(ref_id);
+#endif
+		if (FreqResp_IsActive() || Position_IsActive())
+			continue;                                             // Hold the reference during a sweep or in position mode
+		
+		target = -target;                                       // Flip reference
+		Trajectory_SCurve(target, REF_ACCEL_RPM_S);             // Profile starts at the next control sample
 	}
-}
\ No newline at end of file
+}
+
+SRAM2_END
@@ -3,11 +3,15 @@
 #include "application.h" 
 #include "controller.h"
 #include "peripherals.h"
+#include "pipeline.h"
 
 /* Global variables ----------------------------------------------------------*/
 int32_t reference, velocity, control;
 uint32_t millisec;
 
+// Encoder velocity -> selected controller -> PWM, composed at compile time
+PIPELINE_DEFINE(loop_pipeline, Peripheral_Encoder_CalculateVelocity, Pipeline_Controller, Pipeline_NoLimit, Peripheral_PWM_ActuateMotor)
+
 /* Functions -----------------------------------------------------------------*/
 
 /* Run setup needed for all periodic tasks */
@@ -48,13 +52,10 @@ void Application_Loop()
   // Every 10 msec ...
   if (millisec % PERIOD_CTRL == 0)
   {
-    // Calculate motor velocity
-    velocity = Peripheral_Encoder_CalculateVelocity(millisec);
-
-    // Calculate control signal
-    control = Controller_PIController(&reference, &velocity, &millisec);
-
-    // Apply control signal to motor
-    Peripheral_PWM_ActuateMotor(control);
+    // Calculate motor velocity, control signal and apply it to the motor
+    ctrl_state_t sample = { .millisec = millisec, .reference = reference };
+    loop_pipeline_step(&sample);
+    velocity = sample.velocity;
+    control  = sample.control;
   }
 }
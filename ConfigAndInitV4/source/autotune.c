@@ -0,0 +1,178 @@
+#include "autotune.h"
+#include "controller.h"
+#include "fixedpoint.h"
+#include <stdint.h>
+
+// This file implements relay-feedback (Astrom-Hagglund) autotuning of the PI
+// controller, using ONLY integer math.
+// A relay with hysteresis drives the motor around a setpoint, which settles in
+// a limit cycle. From its period Tu and amplitude a the ultimate gain is
+//   Ku = 4 * d / (pi * sqrt(a^2 - eps^2))
+// and the PI gains follow from the Tyreus-Luyben rules (less overshoot than
+// Ziegler-Nichols):
+//   Kp = 0.31 * Ku, Ti = 2.2 * Tu
+// Finally they are converted to the units of ctrl_params_t (Q15 on an error
+// normalised by RPM_SCALE).
+
+/* ===================== Config (tune in Watch) ===================== */
+
+// Set to 1 to start an experiment at the next control step.
+volatile int32_t AUTOTUNE_REQUEST = 0;
+
+#define AUTOTUNE_SETPOINT_RPM 1000          // Centre of the limit cycle
+#define AUTOTUNE_RELAY        107374182     // Relay amplitude d (Q30), 10% duty
+#define AUTOTUNE_HYST_RPM     20            // Relay hysteresis eps (above encoder noise)
+#define AUTOTUNE_SETTLE_MS    500           // Feedforward-only run-up before the relay starts
+#define AUTOTUNE_SKIP         2             // Limit cycles ignored while the oscillation builds up
+#define AUTOTUNE_CYCLES       4             // Limit cycles averaged
+#define AUTOTUNE_TIMEOUT_MS   8000          // Give up after this time
+
+enum { AT_IDLE, AT_SETTLE, AT_RELAY };
+
+/* ===================== State ===================== */
+
+static volatile uint8_t phase = AT_IDLE;
+static uint8_t first_step = 0;      // Timestamps are taken from the first step after start
+static uint32_t t_start = 0;
+static uint32_t t_rise = 0;         // Time of the last upward relay switch, 0 => none yet
+static int8_t relay = 1;
+static int32_t bias = 0;            // Feedforward for the setpoint (Q30)
+static int32_t vmax = 0, vmin = 0;  // Extremes of the current cycle (RPM)
+static uint8_t cycles = 0;
+static uint32_t period_sum = 0;
+static int32_t amp_sum = 0;
+
+static autotune_result_t result;
+
+/* ===================== Helpers ===================== */
+
+// Integer square root (floor).
+static uint32_t isqrt32(uint32_t x) {
+    uint32_t r = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+// Compute Ku and the PI gains from the averaged limit cycle and apply them.
+static void finish(void) {
+    const uint32_t tu_ms = period_sum / (AUTOTUNE_CYCLES);
+    int32_t a = amp_sum / (AUTOTUNE_CYCLES);
+    if (a <= AUTOTUNE_HYST_RPM)
+        a = AUTOTUNE_HYST_RPM + 1; // Keep sqrt(a^2 - eps^2) positive
+    const int32_t a_eff = (int32_t)isqrt32((uint32_t)(a * a - AUTOTUNE_HYST_RPM * AUTOTUNE_HYST_RPM));
+
+    // Ku = 4 d / (pi a_eff), pi ~ 31416 / 10000
+    const int64_t ku = ((int64_t)4 * AUTOTUNE_RELAY * 10000LL) / (31416LL * a_eff);
+
+    // Kp = 0.31 Ku in Q30/RPM -> Q15 on err/RPM_SCALE
+    int64_t kp = (ku * 31LL * RPM_SCALE) / (100LL * Q15_ONE);
+    // Ki = Kp / Ti, Ti = 2.2 Tu, per second
+    int64_t ki = (kp * 10000LL) / (22LL * (int64_t)tu_ms);
+    if (kp > 32767)
+        kp = 32767;
+    if (ki > 32767)
+        ki = 32767;
+
+    result.ku = (int32_t)ku;
+    result.tu_ms = tu_ms;
+    result.amp_rpm = a;
+    result.kp = (int32_t)kp;
+    result.ki = (int32_t)ki;
+    result.status = 2;
+
+    ctrl_params_t p;
+    Controller_GetParams(&p);
+    p.kp = result.kp;
+    p.ki = result.ki;
+    Controller_SetParams(&p);
+    Controller_Reset(); // Bumpless restart of the PI loop with the new gains
+}
+
+/* ===================== API ===================== */
+
+void Autotune_Start(void) {
+    first_step = 1;
+    result.status = 1;
+    phase = AT_SETTLE;
+}
+
+uint8_t Autotune_IsActive(void) {
+    if (AUTOTUNE_REQUEST) {
+        AUTOTUNE_REQUEST = 0;
+        Autotune_Start();
+    }
+    return phase != AT_IDLE;
+}
+
+int32_t Autotune_Step(int32_t meas_rpm, uint32_t millisec) {
+    if (first_step) {
+        first_step = 0;
+        t_start = millisec;
+
+        ctrl_params_t p;
+        Controller_GetParams(&p);
+        bias = Fix_Sat30Wide((int64_t)p.u_per_rpm * AUTOTUNE_SETPOINT_RPM);
+    }
+
+    if (millisec - t_start > AUTOTUNE_TIMEOUT_MS) {
+        result.status = 3; // No stable limit cycle, keep the old gains
+        phase = AT_IDLE;
+        Controller_Reset();
+        return 0;
+    }
+
+    if (phase == AT_SETTLE) {
+        if (millisec - t_start < AUTOTUNE_SETTLE_MS)
+            return bias;
+
+        phase = AT_RELAY;
+        relay = (meas_rpm < AUTOTUNE_SETPOINT_RPM) ? 1 : -1;
+        t_rise = 0;
+        cycles = 0;
+        period_sum = 0;
+        amp_sum = 0;
+        vmax = vmin = meas_rpm;
+    }
+
+    // Track the extremes of the current cycle
+    if (meas_rpm > vmax)
+        vmax = meas_rpm;
+    if (meas_rpm < vmin)
+        vmin = meas_rpm;
+
+    // Relay with hysteresis, one cycle = upward switch to upward switch
+    const int32_t err = AUTOTUNE_SETPOINT_RPM - meas_rpm;
+    if (relay > 0 && err < -AUTOTUNE_HYST_RPM) {
+        relay = -1;
+    } else if (relay < 0 && err > AUTOTUNE_HYST_RPM) {
+        relay = 1;
+        if (t_rise != 0U && ++cycles > AUTOTUNE_SKIP) {
+            period_sum += millisec - t_rise;
+            amp_sum += (vmax - vmin) / 2;
+            if (cycles == AUTOTUNE_SKIP + AUTOTUNE_CYCLES) {
+                phase = AT_IDLE;
+                finish();
+                return 0;
+            }
+        }
+        t_rise = millisec;
+        vmax = vmin = meas_rpm;
+    }
+
+    return Q30_Add(Q30(bias), Q30(relay > 0 ? AUTOTUNE_RELAY : -AUTOTUNE_RELAY)).v;
+}
+
+void Autotune_GetResult(autotune_result_t* out) {
+    *out = result;
+}
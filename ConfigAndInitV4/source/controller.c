@@ -1,75 +1,184 @@
 #include "controller.h"
+#include "application.h"
+#include "biquad.h"
+#include "ctrldesign.h"
+#include "fixedpoint.h"
+#include "sram2.h"
 #include <stdint.h>
 
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32 && defined (__ARMCC_VERSION) && !defined (__ARM_FP)
+#error "CONTROLLER_LAW_PI_F32 needs the FPU enabled (Use FPU / -mfloat-abi=hard)"
+#endif
+
 // This file implements a PI controller using ONLY integer math.
 // The controller output is in Q30 fixed-point format:
 //   +2^30-1  => +100% duty (full clockwise)
 //   -2^30    => -100% duty (full counter-clockwise)
 // The application calls Controller_PIController() periodically and provides time.
+//
+// The feedforward slope and a Coulomb-like offset adapt online (normalised LMS).
+// At steady state the output u and the measured speed v lie on the motor's
+// static map u = slope * v + offset * sign(v), so each settled sample is one
+// regression point, no matter whether P, I or the feedforward carried it.
+//
+// Around zero speed the offset acts as Coulomb friction compensation: its sign
+// follows the reference through a linear ramp of +-fric_band_rpm instead of a
+// hard switch, and a breakaway term fades in as the speed drops inside the
+// band (linearised Stribeck curve). The breakaway is learned from how long the
+// motor sticks at standstill after each reversal.
+//
+// A disturbance observer inverts the nominal first-order motor model
+//   v[k] = a * v[k-1] + (1 - a) * (u[k-1] - d) / slope,  a = tau / (tau + T)
+// to get the input that explains the measured speed. What the applied input
+// and the feedforward friction model do not explain is load, low-pass
+// filtered (Q-filter) and added to the output.
+//
+// With CONTROLLER_LAW_CASCADE the P and I terms are replaced by a cascade of
+// second-order sections on the speed error (see biquad.h), whose order and
+// Q-format are fixed at compile time. The PI section follows kp, ki and
+// i_clamp of the active parameters (Tustin at PERIOD_CTRL), so Watch,
+// autotune and identification tune it like the PI; the roll-off is fixed.
+// Feedforward, friction and the observer are the same for all laws.
+//
+// CONTROLLER_LAW_PI_F32 computes the PI and feedforward law in float32 on the
+// Cortex-M4F FPU instead, in units of duty (1.0 = full scale). The parameters,
+// the learned feedforward, friction and observer stay integer and are only
+// converted when used. The float build is outside the integer-only rule and
+// meant for production comparisons (see CTRL_BENCH in app-rtos.c).
 
 /* ===================== Units & scaling ===================== */
 
 // Internal control uses signed Q30: full scale = [-2^30, 2^30-1]
 // We use fixed-point (Q30/Q15) because the task forbids floating point,
 // and fixed-point gives predictable, efficient math on the MCU.
-#define CTRL_Q 30
-#define CTRL_MAX ((int32_t)0x3FFFFFFF)
-#define CTRL_MIN ((int32_t)0xC0000000)
-#define Q15_ONE 32768
+// Formats, limits and saturation come from fixedpoint.h.
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+#define Q30_TO_F (1.0f / 1073741824.0f)
+#define F_TO_Q30 1073741824.0f
+#endif
+
+// Everything below, code and state, runs from SRAM2 when CTRL_IN_SRAM2 is set.
+SRAM2_BEGIN
 
 /* ===================== Config (tune in Watch) ===================== */
 
-// Normalize RPM error into Q15 before applying gains.
-// We only expect an error of 4000 max, using 6000 for marign
-#define RPM_SCALE 6000
+// RPM error is normalized into Q15 by RPM_SCALE (controller.h) before applying gains.
+
+// Parameter staging block (tune in Watch): edit the fields, then set
+// ctrl_tune_commit = 1. The controller picks the whole set up between two
+// steps, so a half-written change is never used.
+volatile ctrl_params_t ctrl_tune = {
+    .kp = 100,                   // PI gains in Q15 (0..32767 ~ 0..1.0)
+    .ki = 6000,                  // start here once P is stable
+    .u_per_rpm = 99000,          // Feedforward: set to 0 to disable. Units: Q30 per RPM.
+    .u_per_rpm_s = 0,            // Acceleration feedforward, ~u_per_rpm * motor time constant [s]. Units: Q30 per RPM/s.
+    .err_deadband_rpm = 10,      // ignore tiny error (helps jitter)
+    .int_window_rpm = 200,       // if |error| <= int_window_rpm then integrator updates
+    .i_clamp = 300000000,        // Clamp integrator to prevent overflow / windup (Q30 units)
+    .ff_adapt_rate = 1024,       // NLMS step size in Q16 (1024 = 1/64 per step), 0 = fixed feedforward
+    .fric_band_rpm = 20,         // Friction sign ramp / Stribeck band, 0 = offset switches on the reference sign only
+    .dob_tau_ms = 0,             // Nominal motor time constant for the disturbance observer, 0 = observer off
+    .dob_q_ms = 50,              // Q-filter time constant of the observer (noise vs recovery speed)
+};
+volatile uint8_t ctrl_tune_commit = 1; // Apply ctrl_tune at the first step
+
+// Feedforward adaptation limits
+#define FF_ADAPT_MIN_RPM      300        // Only learn away from zero speed
+#define FF_ADAPT_SETTLE_MS    300        // Steady time required before learning
+#define FF_SLOPE_STEP_MAX     50         // Max slope change per step (Q30 per RPM), ~5%/s at 99000
+#define FF_OFFSET_STEP_MAX    100000     // Max offset change per step (Q30), ~1% duty/s
+#define FF_OFFSET_MAX         214748364  // Offset bound (Q30), 20% duty
+
+// Breakaway learning
+#define FRIC_STILL_RPM        5          // Below this the motor is taken as stuck (~2 encoder counts per sample)
+#define FRIC_STALL_MS         20         // Accepted time stuck per reversal
+#define FRIC_LEARN_STEP       2684354    // Breakaway change per reversal (Q30), 0.25% duty
+#define FRIC_BREAKAWAY_MAX    214748364  // Breakaway bound (Q30), 20% duty
+
+// Disturbance observer
+#define DOB_MAX               214748364  // Compensation bound (Q30), 20% duty
 
-// PI gains in Q15 (0..32767 ~ 0..1.0)
-volatile int32_t Kp = 100;
-volatile int32_t Ki = 6000; // start here once P is stable
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+// Feedback cascade: speed error in Q15 -> output in Q30, coefficients in Q16
+// for the sample time PERIOD_CTRL.
+#define LAW_STAGES 2
+#define LAW_Q      16
+BIQUAD_CASCADE_DEFINE(ctrl_law, LAW_STAGES, LAW_Q)
 
-// Feedforward: set to 0 to disable. Units: Q30 per RPM.
-volatile int32_t U_PER_RPM = 99000;
+// The first-order roll-off at 20 Hz is fixed, designed in continuous time
+// (ctrldesign.h) and folded to constants in the initializer; a bad design
+// stops the build. The PI section is set at every parameter swap (law_set()).
+#define LAW_T_NS     (PERIOD_CTRL * 1000000LL)
+#define LAW_TAU_NS   7957747LL   // 1 / (2 pi 20 Hz)
 
-// Noise handling
-volatile int32_t ERR_DEADBAND_RPM = 10; // ignore tiny error (helps jitter)
+static ctrl_law_t ctrl_law = {
+    .c = {
+        [1] = DESIGN_LOWPASS_TUSTIN(LAW_TAU_NS, LAW_T_NS, LAW_Q, CTRL_MIN, CTRL_MAX),
+    },
+};
+#endif
 
-// Integrate only when close to target:
-// if |error| <= INT_WINDOW_RPM then integrator updates
-volatile int32_t INT_WINDOW_RPM = 200;
+/* ===================== Parameter blocks ===================== */
 
-// Clamp integrator to prevent overflow / windup (Q30 units)
-volatile int32_t I_CLAMP = 300000000;
+// Active parameters plus constants derived from them once per swap.
+typedef struct {
+    ctrl_params_t p;
+    uint32_t version;
+    int32_t err_scale;  // err_rpm -> Q15 multiplier, Q16 (replaces / RPM_SCALE)
+    int32_t ki_ms;      // Ki per millisecond, Q16 (replaces / 1000)
+    int32_t dob_k1;     // (tau + T) / T, Q16 (inverse model, current speed)
+    int32_t dob_k0;     // tau / T, Q16 (inverse model, previous speed)
+    int32_t dob_alpha;  // T / (Tq + T), Q16 (Q-filter)
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+    float kp_f;         // Duty per RPM
+    float ki_f;         // Duty per RPM and ms
+    float i_clamp_f;    // Duty
+    float accel_ff_f;   // Duty per RPM/s
+#endif
+} ctrl_block_t;
+
+// Double buffer: the controller only reads 'active', a swap writes the other
+// block and then moves the pointer with a single store.
+static ctrl_block_t blocks[2];
+static const ctrl_block_t *volatile active = &blocks[0];
 
 /* ===================== Controller state ===================== */
 
 // Integrator state in Q30
-static int32_t integrator = 0;
+static q30_t integrator = { 0 };
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+// Integrator state in duty
+static float integrator_f = 0.0f;
+#endif
 // Time of previous control update (ms)
 static uint32_t last_update_ms = 0;
 // Used to force "first call after reset returns 0"
 static uint8_t first_call = 1;
+// Reference derivative for feedforward (RPM/s)
+static int32_t ref_rate_rpm_s = 0;
+// Learned feedforward: slope (Q30 per RPM) and offset (Q30, applied with the reference sign)
+static int32_t ff_slope = 0;
+static int32_t ff_offset = 0;
+// Time spent at steady state (ms) and external freeze of the adaptation
+static uint32_t steady_ms = 0;
+static volatile uint8_t ff_frozen = 0;
+// Adaptation step waiting for the applied control of its sample (speed, reference sign)
+static uint8_t ff_pending = 0;
+static int32_t ff_pending_rpm = 0;
+static int32_t ff_pending_sgn = 0;
+// Breakaway boost at standstill (Q30) and the reversal being timed
+static int32_t fric_breakaway = 0;
+static int32_t stall_dir = 0;     // Reference direction of the current episode
+static uint8_t stall_timing = 0;  // Set until the motor leaves the band in that direction
+static uint32_t stall_ms = 0;
+// Disturbance observer: filtered estimate (Q30), last speed and applied input
+static int32_t dob_est = 0;
+static int32_t dob_prev_rpm = 0;
+static int32_t dob_prev_u = 0;
+static uint8_t dob_valid = 0;
 
 /* ===================== Helpers ===================== */
 
-// Saturate to the valid controller output range (Q30).
-// We use 64-bit inputs to avoid overflow during intermediate math.
-static inline int32_t sat_ctrl(int64_t x) {
-    if (x > (int64_t)CTRL_MAX)
-        return CTRL_MAX;
-    if (x < (int64_t)CTRL_MIN)
-        return CTRL_MIN;
-    return (int32_t)x;
-}
-
-// Clamp to signed 16-bit range used by Q15.
-static inline int32_t clamp_q15(int64_t x) {
-    if (x > 32767)
-        return 32767;
-    if (x < -32768)
-        return -32768;
-    return (int32_t)x;
-}
-
 // Integer absolute value (32-bit).
 static inline int32_t iabs32(int32_t x) {
     if (x < 0) {
@@ -78,25 +187,209 @@ static inline int32_t iabs32(int32_t x) {
     return x;
 }
 
-// Clamp to [lo, hi].
-static inline int32_t clamp_i32(int32_t x, int32_t lo, int32_t hi) {
-    if (x > hi)
-        return hi;
-    if (x < lo)
-        return lo;
-    return x;
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+// Round a gain given as num / den to the Q of the cascade, bounded to int32.
+static int32_t law_coef(int64_t num, int64_t den) {
+    const int64_t half = (num < 0) ? -den / 2 : den / 2;
+    const int64_t c = (num * (1LL << LAW_Q) + half) / den;
+    return (c > INT32_MAX) ? INT32_MAX : ((c < INT32_MIN) ? INT32_MIN : (int32_t)c);
+}
+
+// PI section C(s) = kp (1 + 1 / (Ti s)), Ti = kp / ki, Tustin at T = PERIOD_CTRL:
+//   b0 = kp + ki T / 2, b1 = -kp + ki T / 2, a1 = -1,
+// bounded to +/-i_clamp like the PI integrator, which is its anti-windup.
+static void law_set(const ctrl_params_t *p) {
+    const int64_t ki_t = (int64_t)p->ki * PERIOD_CTRL; // ki * T, scaled by 1000
+    ctrl_law.c[0] = (biquad_coef_t){
+        .b0 = law_coef((int64_t)p->kp * 2000 + ki_t, 2000),
+        .b1 = law_coef(-(int64_t)p->kp * 2000 + ki_t, 2000),
+        .a1 = -(1 << LAW_Q),
+        .y_min = -p->i_clamp,
+        .y_max = p->i_clamp,
+    };
 }
+#endif
+
+// Copy the staged parameters into the inactive block, derive constants and swap.
+static void params_swap(void) {
+    const ctrl_block_t *cur = active;
+    ctrl_block_t *next = (cur == &blocks[0]) ? &blocks[1] : &blocks[0];
+
+    next->p = ctrl_tune;
+    next->version = cur->version + 1U;
+    next->err_scale = (int32_t)(((int64_t)Q15_ONE << 16) / RPM_SCALE);
+    next->ki_ms = (int32_t)(((int64_t)next->p.ki << 16) / 1000LL);
+    next->dob_k1 = (int32_t)((((int64_t)next->p.dob_tau_ms + PERIOD_CTRL) << 16) / PERIOD_CTRL);
+    next->dob_k0 = (int32_t)(((int64_t)next->p.dob_tau_ms << 16) / PERIOD_CTRL);
+    next->dob_alpha = (int32_t)(((int64_t)PERIOD_CTRL << 16) / ((int64_t)next->p.dob_q_ms + PERIOD_CTRL));
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+    next->kp_f = (float)next->p.kp / ((float)Q15_ONE * RPM_SCALE);
+    next->ki_f = (float)next->p.ki / ((float)Q15_ONE * RPM_SCALE * 1000.0f);
+    next->i_clamp_f = (float)next->p.i_clamp * Q30_TO_F;
+    next->accel_ff_f = (float)next->p.u_per_rpm_s * Q30_TO_F;
+#endif
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+    law_set(&next->p);
+#endif
+
+    // A new hand-set slope restarts the learning from it.
+    if (next->version == 1U || next->p.u_per_rpm != cur->p.u_per_rpm) {
+        ff_slope = next->p.u_per_rpm;
+        ff_offset = 0;
+    }
+
+    active = next;
+}
+
+// One NLMS step on the regressor [v / RPM_SCALE, sign(v)] with the static-map
+// error of the applied output u. Steps are rate limited, both parameters bounded.
+static void ff_adapt(const ctrl_block_t *b, int32_t meas_rpm, int32_t sgn, int32_t u) {
+    const int64_t r_q15 = ((int64_t)meas_rpm * b->err_scale) >> 16;
+    const int64_t norm = r_q15 * r_q15 + ((int64_t)Q15_ONE * Q15_ONE); // |phi|^2 in Q30
+    const int64_t e = (int64_t)u - ((int64_t)ff_slope * meas_rpm + (int64_t)ff_offset * sgn);
+    const int64_t g = (e * b->p.ff_adapt_rate) >> 16;                    // mu * e (Q30)
+
+    // (g * r_q15 * 2^15) / (norm * RPM_SCALE), without the 2^15 in the numerator it cannot overflow
+    int32_t d_slope = (int32_t)((g * r_q15) / ((norm * RPM_SCALE) >> 15));
+    int32_t d_offset = (int32_t)((g * sgn * ((int64_t)Q15_ONE * Q15_ONE)) / norm);
+    d_slope = Fix_Clamp(d_slope, -FF_SLOPE_STEP_MAX, FF_SLOPE_STEP_MAX);
+    d_offset = Fix_Clamp(d_offset, -FF_OFFSET_STEP_MAX, FF_OFFSET_STEP_MAX);
+
+    ff_slope = Fix_Clamp(ff_slope + d_slope, 0, CTRL_MAX / RPM_SCALE);
+    ff_offset = Fix_Clamp(ff_offset + d_offset, -FF_OFFSET_MAX, FF_OFFSET_MAX);
+}
+
+// Friction compensation (Q30): Coulomb on a smooth reference sign, plus the
+// breakaway boost while the motor is slow.
+static int32_t friction(const ctrl_block_t *b, int32_t ref_rpm, int32_t meas_rpm) {
+    const int32_t band = b->p.fric_band_rpm;
+    if (band <= 0)
+        return (ref_rpm > 0) ? ff_offset : ((ref_rpm < 0) ? -ff_offset : 0);
+
+    const int64_t dir = Fix_Clamp(ref_rpm, -band, band); // Smooth sign, scaled by band
+    const int64_t slow = band - Fix_Clamp(iabs32(meas_rpm), 0, band);
+    return Fix_Sat30Wide((dir * ((int64_t)ff_offset * band + (int64_t)fric_breakaway * slow)) /
+                    ((int64_t)band * band));
+}
+
+// Time how long the motor sticks at standstill after every reversal of the
+// reference, and nudge the breakaway by one bounded step per reversal.
+static void fric_learn(const ctrl_block_t *b, int32_t ref_rpm, int32_t meas_rpm, uint32_t delta_ms) {
+    const int32_t band = b->p.fric_band_rpm;
+    if (band <= 0 || iabs32(ref_rpm) < band)
+        return;
+
+    const int32_t dir = (ref_rpm > 0) ? 1 : -1;
+    if (dir != stall_dir) {
+        stall_dir = dir;
+        stall_timing = 1;
+        stall_ms = 0;
+    }
+    if (!stall_timing)
+        return;
+
+    if ((int64_t)meas_rpm * dir < band) {
+        if (iabs32(meas_rpm) <= FRIC_STILL_RPM)
+            stall_ms += delta_ms;
+        return;
+    }
+    stall_timing = 0;
+    if (ff_frozen)
+        return;
+    if (stall_ms > FRIC_STALL_MS)
+        fric_breakaway = Fix_Clamp(fric_breakaway + FRIC_LEARN_STEP, 0, FRIC_BREAKAWAY_MAX);
+    else
+        fric_breakaway = Fix_Clamp(fric_breakaway - FRIC_LEARN_STEP / 4, 0, FRIC_BREAKAWAY_MAX);
+}
+
+// Update the load estimate from the input applied in the previous period and
+// the new speed. Cost: 4 multiplies (plus the friction model inside its band).
+static void dob_update(const ctrl_block_t *b, int32_t meas_rpm) {
+    if (b->p.dob_tau_ms <= 0 || ff_slope == 0) {
+        dob_est = 0;
+        dob_valid = 0;
+        return;
+    }
+    if (dob_valid) {
+        // Input that explains the speed change under the nominal model
+        const int64_t v_drive = ((int64_t)b->dob_k1 * meas_rpm - (int64_t)b->dob_k0 * dob_prev_rpm) >> 16;
+        const int64_t u_model = (int64_t)ff_slope * v_drive + friction(b, meas_rpm, meas_rpm);
+        const int64_t d_raw = (int64_t)dob_prev_u - u_model;
+        const int64_t d = dob_est + ((((int64_t)Fix_Sat30Wide(d_raw) - dob_est) * b->dob_alpha) >> 16);
+        dob_est = Fix_Clamp(Fix_Sat30Wide(d), -DOB_MAX, DOB_MAX);
+    }
+    dob_prev_rpm = meas_rpm;
+    dob_valid = 1;
+}
+
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+// PI + feedforward in float32 (duty units), same structure as the Q30 law:
+// windowed, clamped integrator with conditional anti-windup. The output is
+// saturated in float and converted once with VCVT.
+static int32_t law_f32(const ctrl_block_t *b, int32_t ref_rpm, int32_t meas_rpm, int32_t err_rpm,
+                       uint32_t delta_ms, uint8_t *saturated) {
+    const float ff = ((float)ff_slope * (float)ref_rpm + (float)friction(b, ref_rpm, meas_rpm) + (float)dob_est) * Q30_TO_F +
+                     b->accel_ff_f * (float)ref_rate_rpm_s;
+
+    // Same error range as the Q15 normalisation
+    const float err = (float)Fix_Clamp(err_rpm, -RPM_SCALE, RPM_SCALE);
+    const float p_term = b->kp_f * err;
+
+    float integrator_candidate = integrator_f;
+    if (iabs32(err_rpm) <= b->p.int_window_rpm) {
+        integrator_candidate += b->ki_f * err * (float)delta_ms;
+        if (integrator_candidate > b->i_clamp_f)
+            integrator_candidate = b->i_clamp_f;
+        else if (integrator_candidate < -b->i_clamp_f)
+            integrator_candidate = -b->i_clamp_f;
+    }
+
+    // Anti-windup: only commit I when output does not saturate further
+    const float candidate = ff + p_term + integrator_candidate;
+    *saturated = (candidate >= 1.0f || candidate < -1.0f);
+    const uint8_t pushes_further = (candidate >= 1.0f && err > 0.0f) || (candidate < -1.0f && err < 0.0f);
+    if (!pushes_further)
+        integrator_f = integrator_candidate;
+
+    const float u = ff + p_term + integrator_f;
+    if (u >= 1.0f)
+        return CTRL_MAX;
+    if (u < -1.0f)
+        return CTRL_MIN;
+    return (int32_t)(u * F_TO_Q30);
+}
+#endif
 
 /* ===================== API ===================== */
 
 int32_t Controller_PIController(const int32_t *reference,
                                 const int32_t *measured,
                                 const uint32_t *millisec) {
+    // Swap in new parameters between steps only.
+    if (ctrl_tune_commit) {
+        ctrl_tune_commit = 0;
+        params_swap();
+    }
+    const ctrl_block_t *const b = active;
+
+    // Finish the adaptation step of the previous sample, now that its applied control is known.
+    if (ff_pending) {
+        ff_pending = 0;
+        if (!ff_frozen)
+            ff_adapt(b, ff_pending_rpm, ff_pending_sgn, dob_prev_u);
+    }
+
     // First call after reset must return zero and initialize state.
     if (first_call) {
         first_call = 0;
         last_update_ms = *millisec;
-        integrator = 0;
+        integrator = Q30(0);
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+        ctrl_law_reset(&ctrl_law);
+#endif
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+        integrator_f = 0.0f;
+#endif
         return 0;
     }
 
@@ -114,52 +407,163 @@ int32_t Controller_PIController(const int32_t *reference,
     int32_t err_rpm = ref_rpm - meas_rpm;
 
     // Deadband for noise
-    if (iabs32(err_rpm) <= ERR_DEADBAND_RPM)
+    if (iabs32(err_rpm) <= b->p.err_deadband_rpm)
         err_rpm = 0;
 
+    // Load estimate, added as compensation (zero while the observer is off)
+    dob_update(b, meas_rpm);
+
+    const int32_t sgn = (ref_rpm > 0) ? 1 : ((ref_rpm < 0) ? -1 : 0);
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+    uint8_t saturated;
+    const int32_t u = law_f32(b, ref_rpm, meas_rpm, err_rpm, delta_ms, &saturated);
+#else
     // Normalize error to Q15 so Q15*Q15 -> Q30 (matches control output format).
     // err_q15 ~= err_rpm / RPM_SCALE, scaled by 2^15
-    const int32_t err_q15 = clamp_q15(((int64_t)err_rpm * (int64_t)Q15_ONE) / (int64_t)RPM_SCALE);
+    const q15_t err_q15 = Q15_Sat(((int64_t)err_rpm * (int64_t)b->err_scale) >> 16);
 
-    // Feedforward (set U_PER_RPM = 0 to disable)
-    // Units: (Q30 per RPM) * RPM = Q30
-    const int32_t ff = sat_ctrl((int64_t)U_PER_RPM * (int64_t)ref_rpm);
+    // Feedforward (set u_per_rpm / u_per_rpm_s = 0 to disable)
+    // Units: (Q30 per RPM) * RPM + Q30 + (Q30 per RPM/s) * RPM/s = Q30
+    const int32_t ff = Fix_Sat30Wide((int64_t)ff_slope * (int64_t)ref_rpm + (int64_t)friction(b, ref_rpm, meas_rpm) +
+                                (int64_t)b->p.u_per_rpm_s * (int64_t)ref_rate_rpm_s);
+    const int32_t ff_dob = Fix_QAdd(ff, dob_est);
 
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+    // Feedback from the section cascade, each section saturates on its own
+    const int32_t fb = ctrl_law_step(&ctrl_law, err_q15.v);
+    const int32_t ctrl_candidate = Fix_QAdd(ff_dob, fb);
+    const uint8_t saturated = (Fix_Sat30(ctrl_candidate) != ctrl_candidate);
+#else
     // P term: Q15 * Q15 -> Q30
-    const int32_t p_term = sat_ctrl((int64_t)Kp * (int64_t)err_q15);
+    const q30_t p_term = Q15_Mul(Q15(Fix_Sat15(b->p.kp)), err_q15);
 
     // I update only when close enough (reduces windup on large steps)
-    int32_t integrator_candidate = integrator;
-    if (iabs32(err_rpm) <= INT_WINDOW_RPM) {
-        // Integrate with respect to time (ms -> seconds via /1000).
+    q30_t integrator_candidate = integrator;
+    if (iabs32(err_rpm) <= b->p.int_window_rpm) {
+        // Integrate with respect to time (ki_ms already holds Ki / 1000).
         // di is in Q30 because Ki(Q15) * err(Q15) => Q30.
-        const int64_t di = ((int64_t)Ki * (int64_t)err_q15 * (int64_t)delta_ms) / 1000LL;
-        integrator_candidate = sat_ctrl((int64_t)integrator + di);
-        integrator_candidate = clamp_i32(integrator_candidate, -I_CLAMP, I_CLAMP);
+        const int64_t di = ((int64_t)b->ki_ms * (int64_t)err_q15.v * (int64_t)delta_ms) >> 16;
+        integrator_candidate = Q30(Fix_Clamp(Fix_Sat30Wide((int64_t)integrator.v + di), -b->p.i_clamp, b->p.i_clamp));
     }
 
     // Anti-windup: only commit I when output does not saturate further
-    const int64_t ctrl_candidate = (int64_t)ff + (int64_t)p_term + (int64_t)integrator_candidate;
-    const int32_t ctrl_sat = sat_ctrl(ctrl_candidate);
-    if ((int64_t)ctrl_sat == ctrl_candidate) {
+    // Q30 terms summed with QADD: out of range stays out of range, sign kept
+    const int32_t ctrl_candidate = Fix_QAdd(ff_dob, Q30_AddWide(p_term, integrator_candidate));
+    const int32_t ctrl_sat = Fix_Sat30(ctrl_candidate);
+    const uint8_t saturated = (ctrl_sat != ctrl_candidate);
+    if (!saturated) {
         // Not saturated -> accept integrator update.
         integrator = integrator_candidate;
     } else {
         // Saturated: only accept I if it moves away from saturation.
         const uint8_t pushes_further =
-            (ctrl_candidate > (int64_t)CTRL_MAX && err_q15 > 0) ||
-            (ctrl_candidate < (int64_t)CTRL_MIN && err_q15 < 0);
+            (ctrl_candidate > CTRL_MAX && err_q15.v > 0) ||
+            (ctrl_candidate < CTRL_MIN && err_q15.v < 0);
         if (!pushes_further)
             integrator = integrator_candidate;
     }
+    const int32_t fb = Q30_AddWide(p_term, integrator);
+#endif
 
     // Final control output (Q30).
-    return sat_ctrl((int64_t)ff + (int64_t)p_term + (int64_t)integrator);
+    const int32_t u = Fix_Sat30(Fix_QAdd(ff_dob, fb));
+#endif
+    dob_prev_u = u; // Replaced by Controller_SetAppliedControl() if later stages add to it
+
+    fric_learn(b, ref_rpm, meas_rpm, delta_ms);
+
+    // Adapt the feedforward only once the speed has settled at a constant
+    // reference, away from zero and in the reference direction. The step
+    // runs at the next call, on the control that was actually applied.
+    const uint8_t steady = !saturated && ref_rate_rpm_s == 0 &&
+                           iabs32(ref_rpm) >= FF_ADAPT_MIN_RPM &&
+                           (int64_t)meas_rpm * sgn >= FF_ADAPT_MIN_RPM;
+    steady_ms = steady ? (steady_ms + delta_ms) : 0U;
+    if (steady_ms >= FF_ADAPT_SETTLE_MS && !ff_frozen &&
+        b->p.ff_adapt_rate != 0 && b->p.u_per_rpm != 0) {
+        ff_pending = 1;
+        ff_pending_rpm = meas_rpm;
+        ff_pending_sgn = sgn;
+    }
+
+    return u;
 }
 
 void Controller_Reset(void) {
+    // Pending parameters take effect from the restart.
+    if (ctrl_tune_commit) {
+        ctrl_tune_commit = 0;
+        params_swap();
+    }
+
     // Reset internal state so the next PI call returns 0 once.
-    integrator = 0;
+    integrator = Q30(0);
+#if CONTROLLER_LAW == CONTROLLER_LAW_CASCADE
+    ctrl_law_reset(&ctrl_law);
+#endif
+#if CONTROLLER_LAW == CONTROLLER_LAW_PI_F32
+    integrator_f = 0.0f;
+#endif
     last_update_ms = 0;
     first_call = 1;
-}
\ No newline at end of file
+    steady_ms = 0;
+    stall_dir = 0;
+    stall_timing = 0;
+    dob_est = 0;
+    dob_valid = 0;
+
+    // Forget the learned feedforward and friction, learning restarts from u_per_rpm.
+    ff_slope = active->p.u_per_rpm;
+    ff_offset = 0;
+    fric_breakaway = 0;
+    ff_pending = 0;
+}
+
+void Controller_SetReferenceRate(int32_t rate_rpm_s) {
+    ref_rate_rpm_s = rate_rpm_s;
+}
+
+void Controller_SetAppliedControl(int32_t control) {
+    dob_prev_u = control;
+}
+
+int32_t Controller_GetDisturbance(void) {
+    return dob_est;
+}
+
+void Controller_FreezeAdaptation(uint8_t freeze) {
+    ff_frozen = freeze;
+}
+
+void Controller_GetFeedforward(int32_t *slope, int32_t *offset) {
+    *slope = ff_slope;
+    *offset = ff_offset;
+}
+
+void Controller_GetFriction(int32_t *coulomb, int32_t *breakaway) {
+    *coulomb = ff_offset;
+    *breakaway = fric_breakaway;
+}
+
+void Controller_SetParams(const ctrl_params_t *params) {
+    // Hold off the swap while the staging block is being rewritten.
+    ctrl_tune_commit = 0;
+    ctrl_tune = *params;
+    ctrl_tune_commit = 1;
+}
+
+uint32_t Controller_GetParams(ctrl_params_t *params) {
+    const ctrl_block_t *b;
+    uint32_t version;
+
+    // Retry if the controller swapped twice while copying.
+    do {
+        b = active;
+        version = b->version;
+        *params = b->p;
+    } while (b != active || version != b->version);
+
+    return version;
+}
+
+SRAM2_END
@@ -0,0 +1,59 @@
+/**
+ * Handles the control-loop state shared between threads, without locks.
+ *
+ * @file ctrlstate.c
+ *
+ * Sequence lock over two buffers: the writer bumps 'seq' to odd, fills the
+ * buffer the readers are NOT using, then bumps 'seq' back to even. The newest
+ * complete sample is always buf[(seq >> 1) & 1], also while a write is in
+ * progress, so a reader that preempts the writer never has to wait. A reader
+ * only retries when the writer lapped it and rewrote the buffer it was copying.
+ */
+
+#include "ctrlstate.h"
+#include "stm32l4xx.h"
+#include "sram2.h"
+#include <stdint.h>
+
+SRAM2_BEGIN // Publish/read and the buffers, when CTRL_IN_SRAM2 is set
+
+/* ----------------- State ----------------- */
+
+static ctrl_state_t buf[2];
+static volatile uint32_t seq = 0; // 2 * (completed writes) + (1 while writing)
+
+/* ----------------- API ----------------- */
+
+void CtrlState_Publish(const ctrl_state_t* state)
+{
+	const uint32_t s = seq;
+	ctrl_state_t* dst = &buf[((s >> 1) + 1U) & 1U]; // The buffer not handed out to readers
+
+	seq = s + 1U; // Odd: write in progress
+	__DMB();
+
+	*dst = *state;
+
+	__DMB();
+	seq = s + 2U; // Even: dst is now the newest sample
+}
+
+uint32_t CtrlState_Read(ctrl_state_t* state)
+{
+	uint32_t s1, s2;
+
+	do
+	{
+		s1 = seq;
+		__DMB();
+
+		*state = buf[(s1 >> 1) & 1U];
+
+		__DMB();
+		s2 = seq;
+	} while ((s2 - (s1 & ~1U)) >= 3U); // Buffer reused only once the next-but-one write has started
+
+	return s1 >> 1;
+}
+
+SRAM2_END
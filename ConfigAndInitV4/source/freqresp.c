@@ -0,0 +1,268 @@
+#include "freqresp.h"
+#include "application.h"
+#include "fixedpoint.h"
+#include <stdint.h>
+
+// This file implements a stepped-sine frequency response measurement, using
+// ONLY integer math.
+// For every frequency a whole number of periods fits the measurement window of
+// N samples, so the excitation sits exactly on a Goertzel bin. The sine itself
+// comes from the same resonator recursion Goertzel uses:
+//   y[n] = 2 cos(w) y[n-1] - y[n-2]
+// and two Goertzel filters (input and output channel) are updated per sample:
+//   s[n] = x[n] + 2 cos(w) s[n-1] - s[n-2]
+// No samples are buffered. At the end of the window each channel gives one
+// complex value; magnitude and angle come from CORDIC, once per point.
+
+/* ===================== Units & scaling ===================== */
+
+#define SAMPLES_PER_S (1000 / PERIOD_CTRL)
+#define DEG_Q16(d) ((int32_t)(d) * 65536)
+#define CORDIC_K_Q30 652032874 // 1 / CORDIC gain for 16 iterations
+
+/* ===================== Config (tune in Watch) ===================== */
+
+// Set to FREQRESP_OPEN_LOOP or FREQRESP_CLOSED_LOOP to start a sweep.
+volatile int32_t FREQRESP_REQUEST = 0;
+
+#define FR_AMP_CTRL     53687091   // Output excitation (Q30), 5% duty
+#define FR_AMP_RPM      200        // Reference excitation (RPM)
+#define FR_MIN_SAMPLES  200        // Shortest measurement window (2 s)
+#define FR_SETTLE_MIN   100        // Shortest settling time before measuring (1 s)
+
+static const uint32_t freqs_mhz[FREQRESP_POINTS] = {
+    500, 1000, 2000, 3000, 5000, 7000, 10000, 15000, 20000, 30000
+};
+
+// atan(2^-i) in Q16 degrees
+static const int32_t atan_q16[16] = {
+    2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+    14668, 7334, 3667, 1833, 917, 458, 229, 115
+};
+
+enum { FR_IDLE, FR_SETTLE, FR_MEASURE };
+
+/* ===================== State ===================== */
+
+static uint8_t mode = 0;
+static uint8_t phase = FR_IDLE;
+static uint8_t point = 0;
+static uint32_t count = 0;         // Samples left in the current phase
+static uint32_t window = 0;        // Measurement window (samples)
+static uint32_t settle = 0;        // Settling time (samples)
+
+static int32_t cos_q30, sin_q30;   // Of the bin frequency
+static int32_t osc1, osc2;         // Resonator state (Q30 control or Q16 RPM)
+static int32_t gin1, gin2;         // Goertzel, input channel
+static int32_t gout1, gout2;       // Goertzel, output channel
+
+static freqresp_point_t table[FREQRESP_POINTS];
+static uint8_t points_done = 0;
+
+/* ===================== Helpers ===================== */
+
+static inline int64_t abs64(int64_t x) {
+    return (x < 0) ? -x : x;
+}
+
+// CORDIC rotation: cos and sin (Q30) of an angle in [0, 180] degrees (Q16).
+static void cordic_rotate(int32_t angle, int32_t *c, int32_t *s) {
+    int32_t x = CORDIC_K_Q30, y = 0, z = angle;
+    if (z > DEG_Q16(90)) {
+        x = 0;
+        y = CORDIC_K_Q30;
+        z -= DEG_Q16(90);
+    }
+    for (int i = 0; i < 16; i++) {
+        const int32_t xs = x >> i, ys = y >> i;
+        if (z >= 0) {
+            x -= ys;
+            y += xs;
+            z -= atan_q16[i];
+        } else {
+            x += ys;
+            y -= xs;
+            z += atan_q16[i];
+        }
+    }
+    *c = x;
+    *s = y;
+}
+
+// CORDIC vectoring: magnitude (scaled by the CORDIC gain, times 2^shift) and angle (Q16 degrees).
+static void cordic_vector(int64_t x64, int64_t y64, int32_t *mag, int32_t *angle, int *shift) {
+    int sh = 0;
+    while (abs64(x64) >= (1LL << 29) || abs64(y64) >= (1LL << 29)) {
+        x64 >>= 1;
+        y64 >>= 1;
+        sh++;
+    }
+    while ((x64 != 0 || y64 != 0) && abs64(x64) < (1LL << 28) && abs64(y64) < (1LL << 28)) {
+        x64 *= 2;
+        y64 *= 2;
+        sh--;
+    }
+
+    int32_t x = (int32_t)x64, y = (int32_t)y64, z = 0;
+    if (x < 0) {
+        x = -x;
+        y = -y;
+        z = DEG_Q16(180);
+    }
+    for (int i = 0; i < 16; i++) {
+        const int32_t xs = x >> i, ys = y >> i;
+        if (y > 0) {
+            x += ys;
+            y -= xs;
+            z += atan_q16[i];
+        } else {
+            x -= ys;
+            y += xs;
+            z -= atan_q16[i];
+        }
+    }
+    if (z > DEG_Q16(180))
+        z -= DEG_Q16(360);
+
+    *mag = x;
+    *angle = z;
+    *shift = sh;
+}
+
+// Set up bin, resonator and filters for the current point.
+static void start_point(void) {
+    const uint32_t f = freqs_mhz[point];
+    const uint32_t fs_mhz = SAMPLES_PER_S * 1000U;
+
+    // Whole number of periods c in a window of N samples, bin frequency = c * fs / N
+    uint32_t c = (FR_MIN_SAMPLES * f + fs_mhz - 1U) / fs_mhz;
+    if (c == 0U)
+        c = 1U;
+    window = (c * fs_mhz + f / 2U) / f;
+    settle = 2U * window / c; // Two periods
+    if (settle < FR_SETTLE_MIN)
+        settle = FR_SETTLE_MIN;
+
+    table[point].freq_mhz = (uint32_t)(((uint64_t)c * fs_mhz) / window);
+    cordic_rotate((int32_t)(((uint64_t)DEG_Q16(360) * c) / window), &cos_q30, &sin_q30);
+
+    // y[0] = 0, y[-1] = -A sin(w)
+    const int32_t amp = (mode == FREQRESP_OPEN_LOOP) ? FR_AMP_CTRL : FR_AMP_RPM * 65536;
+    osc1 = 0;
+    osc2 = (int32_t)(-((int64_t)amp * sin_q30 >> 30));
+
+    gin1 = gin2 = gout1 = gout2 = 0;
+    count = settle;
+    phase = FR_SETTLE;
+}
+
+// Complex Goertzel result -> gain and phase of output relative to input.
+static void finish_point(void) {
+    const int64_t rin  = (int64_t)gin1 - (((int64_t)cos_q30 * gin2) >> 30);
+    const int64_t iin  = ((int64_t)sin_q30 * gin2) >> 30;
+    const int64_t rout = (int64_t)gout1 - (((int64_t)cos_q30 * gout2) >> 30);
+    const int64_t iout = ((int64_t)sin_q30 * gout2) >> 30;
+
+    int32_t mag_in, mag_out, ang_in, ang_out;
+    int sh_in, sh_out;
+    cordic_vector(rin, iin, &mag_in, &ang_in, &sh_in);
+    cordic_vector(rout, iout, &mag_out, &ang_out, &sh_out);
+
+    // Gain: CORDIC gain cancels in the ratio, only the normalisation shifts remain
+    int64_t gain = (mag_in > 0) ? (((int64_t)mag_out << 16) / mag_in) : 0;
+    const int d = sh_out - sh_in;
+    if (d > 0)
+        gain = (d > 30 || gain > (INT32_MAX >> d)) ? INT32_MAX : (gain << d);
+    else
+        gain >>= (-d > 62) ? 62 : -d;
+    table[point].gain_q16 = (gain > INT32_MAX) ? INT32_MAX : (int32_t)gain;
+
+    int32_t ph = ang_out - ang_in;
+    if (ph > DEG_Q16(180))
+        ph -= DEG_Q16(360);
+    else if (ph <= DEG_Q16(-180))
+        ph += DEG_Q16(360);
+    table[point].phase_cdeg = (int32_t)(((int64_t)ph * 100) / 65536);
+
+    points_done = (uint8_t)(point + 1U);
+}
+
+/* ===================== API ===================== */
+
+void FreqResp_Start(uint8_t m) {
+    if (m != FREQRESP_OPEN_LOOP && m != FREQRESP_CLOSED_LOOP)
+        return; // Unknown mode, stay idle
+    mode = m;
+    point = 0;
+    points_done = 0;
+    start_point();
+}
+
+uint8_t FreqResp_IsActive(void) {
+    return phase != FR_IDLE;
+}
+
+int32_t FreqResp_Excitation(void) {
+    if (phase == FR_IDLE || mode != FREQRESP_CLOSED_LOOP)
+        return 0;
+    return osc1 / 65536;
+}
+
+int32_t FreqResp_Step(int32_t control, int32_t ref_rpm, int32_t meas_rpm) {
+    if (phase == FR_IDLE) {
+        const int32_t request = FREQRESP_REQUEST;
+        if (request) {
+            if (request == FREQRESP_OPEN_LOOP || request == FREQRESP_CLOSED_LOOP)
+                FreqResp_Start((uint8_t)request);
+            FREQRESP_REQUEST = 0; // Other values are dropped
+        }
+        return control;
+    }
+
+    // Channels in the same units, so the ratio is dimensionless
+    int32_t u = control;
+    int32_t xin, xout;
+    if (mode == FREQRESP_OPEN_LOOP) {
+        u = Q30_Add(Q30(control), Q30(osc1)).v;
+        xin = u >> 15;           // Plant input (Q15)
+        xout = -(control >> 15); // Controller answer (Q15)
+    } else {
+        xin = ref_rpm * 16;      // Reference (RPM, 4 fractional bits for headroom/resolution balance)
+        xout = meas_rpm * 16;    // Velocity
+    }
+
+    if (phase == FR_MEASURE) {
+        const int32_t gi = xin + (int32_t)(((int64_t)cos_q30 * gin1) >> 29) - gin2;
+        gin2 = gin1;
+        gin1 = gi;
+        const int32_t go = xout + (int32_t)(((int64_t)cos_q30 * gout1) >> 29) - gout2;
+        gout2 = gout1;
+        gout1 = go;
+    }
+
+    // Advance the sine (2 cos(w) in Q29 has the same value as cos(w) in Q30)
+    const int32_t next = (int32_t)(((int64_t)cos_q30 * osc1) >> 29) - osc2;
+    osc2 = osc1;
+    osc1 = next;
+
+    if (--count == 0U) {
+        if (phase == FR_SETTLE) {
+            phase = FR_MEASURE;
+            count = window;
+        } else {
+            finish_point();
+            if (++point < FREQRESP_POINTS)
+                start_point();
+            else
+                phase = FR_IDLE;
+        }
+    }
+
+    return u;
+}
+
+uint8_t FreqResp_GetTable(freqresp_point_t* out) {
+    for (uint8_t i = 0; i < FREQRESP_POINTS; i++)
+        out[i] = table[i];
+    return points_done;
+}
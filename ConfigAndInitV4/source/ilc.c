@@ -0,0 +1,87 @@
+#include "ilc.h"
+#include "fixedpoint.h"
+#include <stdint.h>
+
+// This file implements iterative learning control (ILC) for the periodic
+// reference, using ONLY integer math.
+// Learning law, per table entry k:
+//   corr[k] <- corr[k] - corr[k] / 2^ILC_FORGET_SHIFT + ILC_GAIN * e(k + ILC_LEAD)
+// The update is done in place: at sample i the entry i - ILC_LEAD has already
+// been applied in this cycle, so its new value is used from the next cycle on.
+// Memory: ILC_LEN * 2 bytes (800 bytes at 4000/10 ms) + a few words of state.
+// Cost per sample: one table read, one table write, two multiplies.
+
+/* ===================== Units & scaling ===================== */
+
+#define TABLE_SHIFT 15 // Table holds Q15 of full-scale control (Q30 >> 15)
+
+/* ===================== Config (tune in Watch) ===================== */
+
+// Set to 0 to bypass the correction (learning continues only when enabled).
+volatile int32_t ILC_ENABLE = 1;
+
+// Learning gain, units: Q30 per RPM of error (same units as U_PER_RPM).
+volatile int32_t ILC_GAIN = 30000;
+
+// Samples between control action and its effect on the error.
+#define ILC_LEAD 1
+
+// Forgetting factor 1 - 2^-ILC_FORGET_SHIFT, keeps the learning robust to noise.
+#define ILC_FORGET_SHIFT 7
+
+// Correction limit in table units (Q15 of full scale), 8192 => 25% duty.
+#define ILC_MAX 8192
+
+/* ===================== State ===================== */
+
+static int16_t corr[ILC_LEN];
+static uint16_t cycle_idx = 0;  // Sample within the current half-period
+static int8_t half_sign = 0;    // Sign of the reference in this half-period, 0 => none seen yet
+static uint8_t synced = 0;      // A reversal has been seen, index is aligned with the cycle
+static uint8_t frozen = 0;      // Apply the table but don't update it
+
+/* ===================== API ===================== */
+
+int32_t Ilc_Step(int32_t control, int32_t ref_rpm, int32_t meas_rpm) {
+    // Synchronise on reference reversals (the start of each half-period).
+    const int8_t sign = (ref_rpm > 0) ? 1 : ((ref_rpm < 0) ? -1 : 0);
+    if (sign != 0 && sign != half_sign) {
+        synced = (half_sign != 0); // The soft start from zero is not a reversal
+        half_sign = sign;
+        cycle_idx = 0;
+    }
+    if (!synced)
+        return control;
+
+    const uint16_t i = cycle_idx;
+    if (cycle_idx < ILC_LEN - 1)
+        cycle_idx++; // Hold the last entry if the half-period runs long
+    if (!ILC_ENABLE)
+        return control;
+
+    // Learn: entry ILC_LEAD samples back, error oriented to the positive half-period.
+    if (i >= ILC_LEAD && !frozen) {
+        const int32_t e = (half_sign > 0) ? (ref_rpm - meas_rpm) : (meas_rpm - ref_rpm);
+        const uint16_t k = (uint16_t)(i - ILC_LEAD);
+        int32_t c = corr[k];
+        c -= c >> ILC_FORGET_SHIFT;
+        c += (int32_t)(((int64_t)ILC_GAIN * (int64_t)e) >> TABLE_SHIFT);
+        corr[k] = (int16_t)Fix_Clamp(c, -ILC_MAX, ILC_MAX);
+    }
+
+    // Apply: Q15 table -> Q30, mirrored on the negative half-period.
+    const int32_t u = (int32_t)corr[i] * (1 << TABLE_SHIFT);
+    return Q30_Add(Q30(control), Q30(half_sign > 0 ? u : -u)).v;
+}
+
+void Ilc_FreezeLearning(uint8_t freeze) {
+    frozen = freeze;
+}
+
+void Ilc_Reset(void) {
+    for (uint16_t i = 0; i < ILC_LEN; i++)
+        corr[i] = 0;
+    cycle_idx = 0;
+    half_sign = 0;
+    synced = 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * Handles tickless idle, putting the MCU in STOP2 between control periods.
+ *
+ * @file lowpower.c
+ *
+ * The RTX idle thread is overridden: it suspends the kernel tick, programs
+ * LPTIM1 (clocked by the 32.768 kHz LSE) to wake up LOWPOWER_GUARD_TICKS before
+ * the next timer event and enters STOP2 with interrupts masked, so the wake-up
+ * interrupt cannot run before the elapsed time has been read. The remaining
+ * guard tick runs on the normal SysTick, so the control timer is still
+ * released from the SysTick interrupt.
+ *
+ * LPTIM1 keeps counting through the STOP2 exit and the PLL relock, so that
+ * time is part of the slept time. The whole slept ticks are handed to the
+ * kernel; for the part of a tick left over, SysTick is restarted with a
+ * shortened first period, so the next tick comes at its true time and no
+ * tick is ever added in one go. The counter resolves the slept time to
+ * +-1 LSE tick, so the first tick after a sleep is off by at most 30.5 us,
+ * plus a lag of the time from the counter read to osKernelResume() (a few
+ * us, longer if interrupts are pending at the wake-up).
+ *
+ * @cite https://community.st.com/ysqtg83639/attachments/ysqtg83639/stm32-mcu-products-forum/65216/1/STM32-L476-ProgramReference-RM0351.pdf
+ * @cite https://arm-software.github.io/CMSIS-RTX/latest/theory_of_operation.html#lowPower
+ */
+
+#include "main.h"
+#include "lowpower.h"
+#include "cmsis_os2.h"
+#include "rtx_os.h"
+
+/* ----------------- Config ----------------- */
+
+#define LSE_HZ        32768U
+#define LPTIM_MAX_CNT 0xFFFFU
+
+/* ----------------- State ----------------- */
+
+static volatile uint32_t slept_ticks = 0;
+
+/* ----------------- Helpers ----------------- */
+
+/*
+ * LPTIM1 runs asynchronously to the APB clock, CNT is only valid when two consecutive reads match (Section 33.4.14).
+ */
+static uint32_t lptim_read_cnt(void)
+{
+	uint32_t a, b;
+
+	do
+	{
+		a = LPTIM1->CNT;
+		b = LPTIM1->CNT;
+	} while (a != b);
+
+	return a;
+}
+
+/*
+ * The system clock wakes up on MSI after STOP2, re-enable the PLL and switch back to it (Section 6.2.9).
+ * The PLL configuration and flash latency are retained in STOP2.
+ */
+static void restore_sysclk(void)
+{
+	RCC->CR |= RCC_CR_PLLON;
+	while ((RCC->CR & RCC_CR_PLLRDY) == 0U)
+	{
+		// Wait for PLL lock
+	}
+
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW_Msk) | RCC_CFGR_SW_PLL;
+	while ((RCC->CFGR & RCC_CFGR_SWS_Msk) != RCC_CFGR_SWS_PLL)
+	{
+		// Wait for the switch to take effect
+	}
+}
+
+/*
+ * Restarts SysTick (stopped by osKernelSuspend()) so that its next interrupt comes after 'first' core clocks,
+ * the periods after it have 'reload' + 1 clocks again. The counter is left stopped, osKernelResume() starts it.
+ */
+static void systick_restart(uint32_t first, uint32_t reload)
+{
+	SysTick->LOAD  = first - 1U;
+	SysTick->VAL   = 0U;                         // Clears the counter, it loads LOAD on the next clock
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	while (SysTick->VAL == 0U)
+	{
+		// Wait for the shortened period to be loaded
+	}
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD  = reload;                     // Used from the next reload on
+}
+
+/*
+ * Sleeps in STOP2 for at most 'ticks' kernel ticks, returns the number of whole ticks actually slept.
+ * Called with interrupts disabled, any pending interrupt ends the sleep.
+ */
+static uint32_t sleep_stop2(uint32_t ticks, uint32_t tick_freq)
+{
+	// Part of the current tick that passed before osKernelSuspend() stopped SysTick, in 1 / (LSE_HZ * tick_freq) s
+	const uint32_t reload = SysTick->LOAD;
+	const uint32_t done = (uint32_t)(((uint64_t)(reload - SysTick->VAL) * LSE_HZ) / (reload + 1U));
+
+	// LSE ticks up to the end of the last requested tick
+	uint32_t lse = (uint32_t)(((uint64_t)ticks * LSE_HZ - done + tick_freq - 1U) / tick_freq);
+	if (lse > LPTIM_MAX_CNT)
+		lse = LPTIM_MAX_CNT;
+
+	// Restart the counter from zero in continuous mode, so it also counts the wake-up (ARR only writable while enabled)
+	LPTIM1->CR  = 0;
+	LPTIM1->CR  = LPTIM_CR_ENABLE;
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->ARR = lse;
+	while ((LPTIM1->ISR & LPTIM_ISR_ARROK) == 0U)
+	{
+		// Wait for ARR to be synchronized into the LSE domain
+	}
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+	// Enter STOP2 (Section 5.3.6), WFI also returns on an interrupt that is pending but masked
+	PWR->CR1   = (PWR->CR1 & ~PWR_CR1_LPMS_Msk) | PWR_CR1_LPMS_STOP2;
+	SCB->SCR  |= SCB_SCR_SLEEPDEEP_Msk;
+	__DSB();
+	__WFI();
+	SCB->SCR  &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	restore_sysclk();
+
+	// Re-read the counter if the match came during the first read
+	uint32_t cnt = lptim_read_cnt();
+	const uint32_t matched = LPTIM1->ISR & LPTIM_ISR_ARRM;
+	if (matched != 0U)
+		cnt = lptim_read_cnt();
+	LPTIM1->CR  = 0;
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+
+	// The match (wake-up) is at CNT = ARR, the counter restarts one LSE tick later: period ARR + 1
+	const uint32_t elapsed_lse = (matched == 0U || cnt == lse) ? cnt : lse + 1U + cnt;
+
+	// The counter starts on the LSE edge after CNTSTRT and the read falls inside an LSE tick, each loses up to one:
+	// count one more to centre the error. Whole ticks go to the kernel, the current tick is shortened by the rest.
+	const uint64_t slept = ((uint64_t)elapsed_lse + 1U) * tick_freq + done;
+	const uint32_t whole = (uint32_t)(slept / LSE_HZ);
+	const uint32_t frac  = (uint32_t)(slept - (uint64_t)whole * LSE_HZ);
+
+	systick_restart((uint32_t)(((uint64_t)(LSE_HZ - frac) * (reload + 1U)) / LSE_HZ), reload);
+
+	return whole;
+}
+
+/* ----------------- API ----------------- */
+
+/**
+ * Starts the LSE, clocks LPTIM1 from it and enables its wake-up line
+ */
+void LowPower_Init(void)
+{
+	// LSE lives in the backup domain, unlock it first (Section 5.4.1)
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+	PWR->CR1      |= PWR_CR1_DBP;
+	RCC->BDCR     |= RCC_BDCR_LSEON;
+	while ((RCC->BDCR & RCC_BDCR_LSERDY) == 0U)
+	{
+		// Wait for the 32.768 kHz crystal to start
+	}
+
+	// LPTIM1 clock source = LSE (Section 6.4.28)
+	RCC->CCIPR    = (RCC->CCIPR & ~RCC_CCIPR_LPTIM1SEL_Msk) | RCC_CCIPR_LPTIM1SEL_0 | RCC_CCIPR_LPTIM1SEL_1;
+	RCC->APB1ENR1 |= RCC_APB1ENR1_LPTIM1EN;
+
+	// Prescaler /1, interrupt on autoreload match (IER may only be written while disabled)
+	LPTIM1->CR   = 0;
+	LPTIM1->CFGR = 0;
+	LPTIM1->IER  = LPTIM_IER_ARRMIE;
+
+	// Wake up on MSI, LPTIM1 on EXTI line 32 (Section 14.3)
+	RCC->CFGR  &= ~RCC_CFGR_STOPWUCK;
+	EXTI->IMR2 |= EXTI_IMR2_IM32;
+
+	NVIC_SetPriority(LPTIM1_IRQn, 5);
+	NVIC_EnableIRQ(LPTIM1_IRQn);
+}
+
+uint32_t LowPower_GetSleptTicks(void)
+{
+	return slept_ticks;
+}
+
+/**
+ * Only used to leave STOP2; the idle thread sleeps with interrupts masked and
+ * clears the flag itself, so this only runs if the flag is set outside a sleep
+ */
+void LPTIM1_IRQHandler(void)
+{
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+}
+
+/**
+ * Replaces the (weak) RTX idle thread with a tickless one.
+ * Main_GetTickMillisec() follows the kernel tick, which osKernelResume() corrects for the slept time
+ * and the restarted SysTick keeps in phase.
+ *
+ * @param argument - Thread argument
+ */
+__NO_RETURN void osRtxIdleThread(void *argument)
+{
+	(void)argument;
+	const uint32_t tick_freq = osKernelGetTickFreq();
+
+	for (;;)
+	{
+		uint32_t ticks = osKernelSuspend(); // Ticks until the next timer/delay event, kernel tick stopped
+
+		if (ticks >= LOWPOWER_MIN_TICKS)
+		{
+			uint32_t slept = 0;
+
+			__disable_irq();
+			// An interrupt since osKernelSuspend() may have made a thread ready, then don't sleep
+			if ((SCB->ICSR & (SCB_ICSR_ISRPENDING_Msk | SCB_ICSR_PENDSVSET_Msk)) == 0U)
+				slept = sleep_stop2(ticks - LOWPOWER_GUARD_TICKS, tick_freq);
+			__enable_irq(); // Pending interrupts run here, before the kernel resumes (no SVC with interrupts masked)
+
+			slept_ticks += slept;
+			osKernelResume(slept);
+		}
+		else
+		{
+			osKernelResume(0);
+			__WFI(); // Too short for STOP2, plain sleep until the next tick
+		}
+	}
+}
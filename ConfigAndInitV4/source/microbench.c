@@ -0,0 +1,174 @@
+/**
+ * Handles per-function cycle counts of the control hot path.
+ *
+ * @file microbench.c
+ *
+ * Every case times single calls of one function on a reproducible input
+ * sequence. The input for call i is prepared before the counter is read, so
+ * only the call itself is timed; the cost of the timing (two counter reads
+ * and an indirect call) is measured on an empty function and subtracted.
+ * The same code runs on the target (DWT) and on the host (see
+ * host/source/microbench_host.c).
+ */
+
+#include "microbench.h"
+#include "controller.h"
+#include "peripherals.h"
+#include <stdint.h>
+
+/* ----------------- Inputs ----------------- */
+
+static uint32_t lcg;
+static volatile int32_t sink; // Keeps results alive
+
+static int32_t in_reference, in_measured, in_control;
+static uint32_t in_millisec;
+static int16_t  in_counts;
+
+// Pseudo-random 32-bit value, the same sequence after every reset of lcg.
+static uint32_t rnd(void)
+{
+	lcg = lcg * 1664525U + 1013904223U;
+	return lcg;
+}
+
+// Pseudo-random value in [-amp, amp].
+static int32_t rnd_pm(int32_t amp)
+{
+	return (int32_t)((rnd() >> 8) % (uint32_t)(2 * amp + 1)) - amp;
+}
+
+/* ----------------- Cases ----------------- */
+
+static void prep_pi(uint32_t i)
+{
+	in_millisec += 10;
+	in_reference = ((i / 64U) & 1U) ? -2000 : 2000;                        // Reversal every 64 calls
+	in_measured  = in_reference + (((i & 63U) < 8U) ? rnd_pm(4000) : rnd_pm(100)); // Large errors right after it
+}
+
+static void call_pi(void)
+{
+	sink = Controller_PIController(&in_reference, &in_measured, &in_millisec);
+}
+
+// The encoder register is read only, so the conversion is timed on made-up counter differences.
+static void prep_velocity(uint32_t i)
+{
+	in_counts = ((i & 31U) != 0U) ? (int16_t)rnd_pm(2048) : 0;             // Up to 6000 RPM either way, standstill every 32nd
+}
+
+static void call_velocity(void)
+{
+	sink = Peripheral_Encoder_CountsToRPM(in_counts, 10U);
+}
+
+static void prep_control(uint32_t i)
+{
+	in_control = (int32_t)rnd();                                           // Includes both saturated ends
+	(void)i;
+}
+
+static void call_control_to_counts(void)
+{
+	sink = Peripheral_PWM_ControlToCounts(in_control, 2048U);
+}
+
+static void call_actuate(void)
+{
+	Peripheral_PWM_ActuateMotor(in_control);
+}
+
+static void prep_none(uint32_t i)
+{
+	(void)i;
+}
+
+static void call_none(void)
+{
+}
+
+typedef struct {
+	const char* name;
+	void (*prep)(uint32_t i);
+	void (*call)(void);
+} mb_def_t;
+
+static const mb_def_t cases[MB_CASE_COUNT] = {
+	[MB_PI_CONTROLLER]     = { "Controller_PIController",              prep_pi,       call_pi },
+	[MB_ENCODER_VELOCITY]  = { "Peripheral_Encoder_CountsToRPM",        prep_velocity, call_velocity },
+	[MB_CONTROL_TO_COUNTS] = { "Peripheral_PWM_ControlToCounts",       prep_control,  call_control_to_counts },
+	[MB_PWM_ACTUATE]       = { "Peripheral_PWM_ActuateMotor",          prep_control,  call_actuate },
+};
+
+/* ----------------- Harness ----------------- */
+
+static uint32_t samples[MICROBENCH_N];
+
+// Start the DWT cycle counter (core clock), the host counter needs no setup.
+static void cycles_init(void)
+{
+#if !defined (HW_HOST)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static uint32_t net(uint32_t cycles, uint32_t overhead)
+{
+	return (cycles > overhead) ? cycles - overhead : 0U;
+}
+
+// Time MICROBENCH_N calls into samples[], sorted ascending.
+static void measure(void (*prep)(uint32_t), void (*call)(void))
+{
+	lcg          = 12345U;
+	in_millisec  = 0;
+	in_counts    = 0;
+
+	for (uint32_t i = 0; i < MICROBENCH_N; i++)
+	{
+		prep(i);
+		const uint32_t t0 = Microbench_Cycles();
+		call();
+		samples[i] = Microbench_Cycles() - t0;
+	}
+
+	// Insertion sort, the samples are few and this must not need a heap
+	for (uint32_t i = 1; i < MICROBENCH_N; i++)
+	{
+		const uint32_t v = samples[i];
+		uint32_t j = i;
+		for (; j > 0 && samples[j - 1] > v; j--)
+			samples[j] = samples[j - 1];
+		samples[j] = v;
+	}
+}
+
+void Microbench_Run(mb_case_t c, mb_result_t* result)
+{
+	cycles_init();
+	measure(prep_none, call_none);
+	const uint32_t overhead = samples[0];
+
+	Peripheral_GPIO_DisableMotor();
+	Controller_Reset();
+	measure(cases[c].prep, cases[c].call);
+	Peripheral_PWM_ActuateMotor(0);
+	Controller_Reset(); // Forget what the controller learned from the made-up inputs
+
+	result->min    = net(samples[0], overhead);
+	result->median = net(samples[MICROBENCH_N / 2], overhead);
+	result->max    = net(samples[MICROBENCH_N - 1], overhead);
+}
+
+void Microbench_RunAll(mb_result_t* results)
+{
+	for (int c = 0; c < MB_CASE_COUNT; c++)
+		Microbench_Run((mb_case_t)c, &results[c]);
+}
+
+const char* Microbench_Name(mb_case_t c)
+{
+	return ((unsigned)c < MB_CASE_COUNT) ? cases[c].name : "?";
+}
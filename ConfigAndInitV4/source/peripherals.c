@@ -11,16 +11,18 @@
  */
  
 #include "peripherals.h"
-#include "stm32l4xx.h"
+#include "hw.h"
+#include "fixedpoint.h"
+#include "sram2.h"
 #include <stdint.h>
 
 /* ----------------- Units & scaling ----------------- */
 
-// Control input uses signed Q30: full scale = [-2^30, 2^30-1]
+// Control input uses signed Q30: full scale = [-2^30, 2^30-1] (CTRL_MIN/CTRL_MAX in fixedpoint.h)
 // Fixed-point is used here because the assignment forbids float usage.
-#define CTRL_Q 30
-#define CTRL_MAX ((int32_t)0x3FFFFFFF)
-#define CTRL_MIN ((int32_t)0xC0000000)
+
+// Drivers and their state run from SRAM2 when CTRL_IN_SRAM2 is set.
+SRAM2_BEGIN
 
 /* ----------------- Config (tune in Watch) ----------------- */
 
@@ -31,22 +33,27 @@
 static uint16_t counterPreviousTIM1  = 0;
 static uint32_t milliSecondsPrevious = 0;
 
-// Saturate controller input to the allowed Q30 range.
-// Convert Q30 control value to timer counts in range [0, ARR].
-static inline int32_t ctrl_to_counts(int32_t ctrl, uint32_t top) 
+static uint16_t counterPreviousPosition = 0;
+static int32_t  positionCounts          = 0;
+static uint8_t  positionStarted         = 0;
+
+/* ----------------- Scaling ----------------- */
+
+/**
+ * Saturates controller input to the allowed Q30 range and converts it to
+ * signed timer counts in range [-ARR, ARR]
+ *
+ * @param[in] ctrl - The control value (Q30)
+ * @param[in] top - The timer period in counts (ARR + 1)
+ */
+int32_t Peripheral_PWM_ControlToCounts(int32_t ctrl, uint32_t top) 
 {
 		//Clamping
-    if (ctrl > CTRL_MAX) 
-			ctrl = CTRL_MAX;
-    else if (ctrl < CTRL_MIN) 
-			ctrl = CTRL_MIN;
+    ctrl = Fix_Sat30(ctrl);
 		
-    // Handle CTRL_MIN specially to avoid overflow when negating.
-    int32_t duty = (int32_t)(((int64_t)ctrl * (int64_t)top) >> CTRL_Q);
-
-    // Clip to top
-    if (duty > (int32_t)top - 1)
-        duty = (int32_t)top - 1;
+    // (ctrl * top) >> 30 as the high word of ctrl * 4 top (one SMULL, top < 2^29).
+    // At CTRL_MAX this is top - 1, so only the negative end needs clipping.
+    int32_t duty = Fix_MulHi(ctrl, (int32_t)(top << (32 - CTRL_Q)));
 
     // clip to min
     if (duty < -(int32_t)top + 1)
@@ -64,8 +71,8 @@ void Peripheral_GPIO_EnableMotor(void)
 {	
 	// GPIO - PA5, PA6
 	
-	GPIOA->BSRR = GPIO_PIN_5; // (Section 8.4.7) (PA5 - GPIO_output)
-	GPIOA->BSRR = GPIO_PIN_6; // (Section 8.4.7) (PA6 - GPIO_output)
+	Hw_GPIOA_WriteBSRR(HW_PA5); // (Section 8.4.7) (PA5 - GPIO_output)
+	Hw_GPIOA_WriteBSRR(HW_PA6); // (Section 8.4.7) (PA6 - GPIO_output)
 }
 
 /* 
@@ -75,8 +82,8 @@ void Peripheral_GPIO_DisableMotor(void)
 {
 	// GPIO - PA5, PA6
 	
-	GPIOA->BSRR = (GPIO_PIN_5 << 16); // (Section 8.4.7) (PA5 - GPIO_output)
-	GPIOA->BSRR = (GPIO_PIN_6 << 16); // (Section 8.4.7) (PA6 - GPIO_output)
+	Hw_GPIOA_WriteBSRR(HW_PA5 << 16); // (Section 8.4.7) (PA5 - GPIO_output)
+	Hw_GPIOA_WriteBSRR(HW_PA6 << 16); // (Section 8.4.7) (PA6 - GPIO_output)
 }
 
 /* ----------------- PWM ----------------- */
@@ -88,31 +95,41 @@ void Peripheral_GPIO_DisableMotor(void)
 void Peripheral_PWM_ActuateMotor(int32_t controlDutyCycle) 
 {
 	// ARR is the timer period, so top = ARR + 1 counts.
-	const uint32_t pwm_top = ((TIM3->ARR) + 1); // ARR Auto-Reload Register (Sections 31.3.1) (31.3.9);
-	const int32_t dutyCycle = ctrl_to_counts(controlDutyCycle, pwm_top);
+	const uint32_t pwm_top = (Hw_TIM3_ReadARR() + 1); // ARR Auto-Reload Register (Sections 31.3.1) (31.3.9);
+	const int32_t dutyCycle = Peripheral_PWM_ControlToCounts(controlDutyCycle, pwm_top);
 
 	// Direction is set by choosing which PWM channel is active.
 	if(dutyCycle > 0) // Clockwise: use CCR2, keep CCR1 low.
 	{
-		TIM3->CCR1 = 0;
-		TIM3->CCR2 = (uint16_t)((dutyCycle >> 19) & 0x7FF); // ARR = 2047 => 0x7FF(2047+1) ticks per period According to CubeMX settings for TIM3)
-																												// ARR = 11 bits => CCR can only be 11 bits => shift dutyCycle 19 bits	
+		Hw_TIM3_WriteCCR1(0);
+		Hw_TIM3_WriteCCR2((uint32_t)dutyCycle); // Peripheral_PWM_ControlToCounts() already scaled to timer counts [0, ARR]
 	} 
 	else if(dutyCycle < 0) // Counter-clockwise: use CCR1, keep CCR2 low.
 	{
-			TIM3->CCR1 = (uint16_t)((-dutyCycle >> 19) & 0x7FF); // ARR = 2047 => 0x7FF(2047+1) ticks per period According to CubeMX settings for TIM3)
+			Hw_TIM3_WriteCCR1((uint32_t)-dutyCycle); // Peripheral_PWM_ControlToCounts() already scaled to timer counts [0, ARR]
 			
-			TIM3->CCR2 = 0;
+			Hw_TIM3_WriteCCR2(0);
 	} 
 	else // Motor off
 	{
-			TIM3->CCR1 = 0;
-			TIM3->CCR2 = 0;
+			Hw_TIM3_WriteCCR1(0);
+			Hw_TIM3_WriteCCR2(0);
 	}
 }
 
 /* ----------------- Encoder velocity ----------------- */
 
+/**
+ * Converts a counter difference over a time difference to RPM
+ *
+ * @param[in] counts - Signed counter difference
+ * @param[in] ms - Time difference in milli seconds, not zero
+ */
+int32_t Peripheral_Encoder_CountsToRPM(int16_t counts, uint32_t ms)
+{
+	return (int32_t)(((int64_t)counts * 60000) / (int64_t)(ENCODER_COUNTS_PER_REV * ms));
+}
+
 /**
  * Reads the encoder value and calculates the current velocity in RPM 
  *
@@ -134,7 +151,7 @@ int32_t Peripheral_Encoder_CalculateVelocity(uint32_t ms) // TODO: Handle counte
 	int32_t velocityRPM;
 	
 	// Read the encoder(counter) value
-	uint16_t counter = (uint16_t)(TIM1->CNT & 0xFFFF);
+	uint16_t counter = (uint16_t)(Hw_TIM1_ReadCNT() & 0xFFFF);
 	
 	if (milliSecondsPrevious == 0U) 
 	{
@@ -144,19 +161,44 @@ int32_t Peripheral_Encoder_CalculateVelocity(uint32_t ms) // TODO: Handle counte
 			return 0;
 	}
 	
-	uint16_t counterDifference      = counter - counterPreviousTIM1;
+	// Signed 16-bit difference handles reverse motion and counter wrap-around
+	int16_t  counterDifference      = (int16_t)(uint16_t)(counter - counterPreviousTIM1);
 	uint32_t milliSecondsDifference = ms - milliSecondsPrevious;
 	
 	if(counterDifference == 0 || milliSecondsDifference == 0)
 		return 0;
 	
-	velocityRPM = (int32_t)(((int64_t)counterDifference * 60000) / (ENCODER_COUNTS_PER_REV * milliSecondsDifference));
-	
-	if(counterPreviousTIM1 > counter) // Handles the reverse case
-		velocityRPM = -1 * velocityRPM;
+	velocityRPM = Peripheral_Encoder_CountsToRPM(counterDifference, milliSecondsDifference);
 	
 	counterPreviousTIM1      = counter;
 	milliSecondsPrevious     = ms;
 	
 	return velocityRPM;
-}
\ No newline at end of file
+}
+
+/* ----------------- Encoder position ----------------- */
+
+/**
+ * Extends the 16-bit encoder counter to a 32-bit position in counts
+ */
+int32_t Peripheral_Encoder_GetPosition(void)
+{
+	// Read the encoder(counter) value
+	uint16_t counter = (uint16_t)(Hw_TIM1_ReadCNT() & 0xFFFF);
+	
+	if (!positionStarted)
+	{
+		counterPreviousPosition = counter;
+		positionStarted = 1;
+		
+		return positionCounts;
+	}
+	
+	// Signed 16-bit difference handles counter wrap-around in both directions
+	positionCounts += (int16_t)(uint16_t)(counter - counterPreviousPosition);
+	counterPreviousPosition = counter;
+	
+	return positionCounts;
+}
+
+SRAM2_END
@@ -0,0 +1,262 @@
+/**
+ * Handles position mode, cascaded around the velocity PI controller.
+ *
+ * @file position.c
+ *
+ * A move profile advances the position setpoint with limited velocity and
+ * acceleration. It brakes on the stopping distance v^2 / (2a), so no move
+ * time has to be planned ahead. The outer loop adds P (and optionally I) on
+ * the position error, plus a lead that covers the lag of the velocity loop
+ * while accelerating, to the profile velocity and hands the sum to the PI
+ * controller as its velocity reference. Position is in Q16 encoder counts,
+ * velocity in Q16 RPM.
+ */
+
+#include "position.h"
+#include "application.h"
+#include <stdint.h>
+
+/* ----------------- Units & scaling ----------------- */
+
+#define POS_Q         16
+#define OUTER_MS      (POSITION_DIVIDER * PERIOD_CTRL)
+#define RPM_LIMIT     6000                      // Velocity reference bound (RPM)
+#define MS_PER_MIN    60000
+
+/* ----------------- Config (tune in Watch) ----------------- */
+
+// Set to 1 to move to POSITION_TARGET, or 2 to go back to velocity mode.
+volatile int32_t POSITION_REQUEST     = 0;
+volatile int32_t POSITION_TARGET      = 0;      // Counts
+volatile int32_t POSITION_VMAX_RPM    = 1000;
+volatile int32_t POSITION_ACCEL_RPM_S = 5000;
+
+volatile int32_t POSITION_KP          = 5120;   // Outer P gain, 1/s in Q8 (20 /s)
+volatile int32_t POSITION_KI          = 0;      // Outer I gain, 1/s^2 in Q8, 0 = P only
+volatile int32_t POSITION_LEAD_MS     = 80;     // Velocity lead on the profile acceleration (~ motor time constant),
+                                                // 0 when the controller has acceleration feedforward (u_per_rpm_s)
+
+#define POSITION_I_MAX_RPM    50                // Bound of the outer I term
+#define POSITION_TOLERANCE    32                // In-target window (counts), above what stiction and the velocity deadband leave
+
+/* ----------------- Command (written by other threads) ----------------- */
+
+typedef struct {
+	uint8_t move;                  // 1 = move, 0 = release
+	int32_t target;                // Counts
+	int32_t vmax_rpm;
+	int32_t accel_rpm_s;
+} pos_cmd_t;
+
+static volatile pos_cmd_t cmd;
+static volatile uint8_t cmd_pending = 0;
+
+/* ----------------- State (owned by Position_Step) ----------------- */
+
+static volatile uint8_t active    = 0;
+static volatile uint8_t in_target = 0;
+static uint8_t  divider  = 0;      // Control periods until the next outer update
+
+static int64_t  target   = 0;      // Q16 counts
+static int64_t  pref     = 0;      // Position setpoint (Q16 counts)
+static int32_t  vprof    = 0;      // Profile velocity (Q16 RPM)
+static int32_t  vmax     = 0;      // Q16 RPM
+static int32_t  dv       = 0;      // Velocity change per outer period (Q16 RPM)
+static int32_t  accel    = 0;      // RPM/s
+static int32_t  vint     = 0;      // Outer I term (Q16 RPM)
+
+static int32_t  out_rpm  = 0;      // Held between outer updates
+static int32_t  out_dref = 0;
+
+/* ----------------- Helpers ----------------- */
+
+// Integer square root (floor).
+static uint64_t isqrt64(uint64_t x)
+{
+	uint64_t r = 0;
+	uint64_t bit = 1ULL << 62;
+	while (bit > x)
+		bit >>= 2;
+	while (bit != 0)
+	{
+		if (x >= r + bit)
+		{
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		}
+		else
+		{
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return r;
+}
+
+static inline int64_t clamp_i64(int64_t x, int64_t lo, int64_t hi)
+{
+	if (x > hi)
+		return hi;
+	if (x < lo)
+		return lo;
+	return x;
+}
+
+// Highest speed (Q16 RPM) from which the motor still stops within d counts.
+static int32_t stop_speed(int64_t d_counts)
+{
+	// v^2 = 2 a d, with v in RPM and d in counts: v^2 = a * d * 120 / 2048
+	const uint64_t v2 = ((uint64_t)accel * (uint64_t)d_counts * 120U) / POSITION_COUNTS_PER_REV;
+	if (v2 >= (1ULL << 42))
+		return INT32_MAX;
+	return (int32_t)(isqrt64(v2 << 20) << 6);
+}
+
+// Start a move from the current setpoint, or from the motor if idle.
+static void apply_cmd(int32_t pos_counts, int32_t ref_rpm)
+{
+	const pos_cmd_t c = cmd;
+
+	if (!c.move)
+	{
+		active = 0;
+		in_target = 0;
+		return;
+	}
+
+	if (!active)
+	{
+		pref  = (int64_t)pos_counts * (1 << POS_Q);
+		vprof = ref_rpm * (1 << POS_Q); // Continue from the velocity reference
+		vint  = 0;
+		divider = 0;
+	}
+	target = (int64_t)c.target * (1 << POS_Q);
+	vmax   = (int32_t)(clamp_i64(c.vmax_rpm, 1, RPM_LIMIT) << POS_Q);
+	accel  = (int32_t)clamp_i64(c.accel_rpm_s, 1, 1000000);
+	dv     = (int32_t)(((int64_t)accel << POS_Q) * OUTER_MS / 1000);
+	if (dv == 0)
+		dv = 1;
+	in_target = 0;
+	active = 1;
+}
+
+// Post a command for the control thread (same pattern as Controller_SetParams).
+static void post_cmd(const pos_cmd_t* c)
+{
+	cmd_pending = 0;
+	cmd = *c;
+	cmd_pending = 1;
+}
+
+// Advance the profile and the outer loop by one outer period.
+static void outer_update(int32_t pos_counts)
+{
+	const int32_t vprev = vprof;
+
+	// Position error against the setpoint the motor was asked to reach by now
+	const int64_t err = pref - (int64_t)pos_counts * (1 << POS_Q);
+
+	// Profile: accelerate towards vmax, brake on the stopping distance left
+	// after this period's step at the current speed
+	const int64_t dist = target - pref;
+	const int64_t d_abs = (dist < 0) ? -dist : dist;
+	const int64_t v_abs = (vprof < 0) ? -(int64_t)vprof : vprof;
+	const int64_t d_left = d_abs - (v_abs * POSITION_COUNTS_PER_REV * OUTER_MS) / MS_PER_MIN;
+	int32_t vcmd = (d_left > 0) ? stop_speed(d_left >> POS_Q) : 0;
+	if (vcmd > vmax)
+		vcmd = vmax;
+	if (dist < 0)
+		vcmd = -vcmd;
+
+	if (vprof < vcmd)
+		vprof = (vcmd - vprof > dv) ? vprof + dv : vcmd;
+	else if (vprof > vcmd)
+		vprof = (vprof - vcmd > dv) ? vprof - dv : vcmd;
+
+	const int64_t step = ((int64_t)vprof * POSITION_COUNTS_PER_REV * OUTER_MS) / MS_PER_MIN;
+	if ((dist >= 0 && step >= dist) || (dist <= 0 && step <= dist))
+	{
+		pref = target; // Land exactly on the target, the last step is below dv
+		vprof = 0;
+	}
+	else
+	{
+		pref += step;
+	}
+
+	// Outer loop: P (+ I) on the position error, in RPM
+	const int64_t vp = (err * POSITION_KP * 60) / ((int64_t)POSITION_COUNTS_PER_REV << 8);
+	if (POSITION_KI != 0)
+	{
+		const int64_t di = (err * POSITION_KI * 60 * OUTER_MS) / (((int64_t)POSITION_COUNTS_PER_REV << 8) * 1000);
+		vint = (int32_t)clamp_i64((int64_t)vint + di, -((int64_t)POSITION_I_MAX_RPM << POS_Q), (int64_t)POSITION_I_MAX_RPM << POS_Q);
+	}
+	else
+	{
+		vint = 0;
+	}
+
+	// Lead: the velocity loop lags its reference by about tau * acceleration
+	const int64_t dvprof = (int64_t)vprof - vprev;
+	const int64_t lead = (dvprof * POSITION_LEAD_MS) / OUTER_MS;
+
+	const int64_t vref = clamp_i64((int64_t)vprof + lead + vp + vint, -((int64_t)RPM_LIMIT << POS_Q), (int64_t)RPM_LIMIT << POS_Q);
+	out_rpm  = (int32_t)((vref + (1 << (POS_Q - 1))) >> POS_Q);
+	out_dref = (int32_t)((dvprof * 1000 / OUTER_MS) >> POS_Q); // Profile acceleration for feedforward
+
+	const int64_t e_abs = (err < 0) ? -err : err;
+	in_target = (pref == target && vprev == 0 && e_abs <= ((int64_t)POSITION_TOLERANCE << POS_Q));
+}
+
+/* ----------------- API ----------------- */
+
+void Position_MoveTo(int32_t target_counts, int32_t vmax_rpm, int32_t accel_rpm_s)
+{
+	post_cmd(&(pos_cmd_t){ .move = 1, .target = target_counts, .vmax_rpm = vmax_rpm, .accel_rpm_s = accel_rpm_s });
+}
+
+void Position_Release(void)
+{
+	post_cmd(&(pos_cmd_t){ .move = 0 });
+}
+
+uint8_t Position_IsActive(void)
+{
+	return active;
+}
+
+uint8_t Position_InTarget(void)
+{
+	return in_target;
+}
+
+uint8_t Position_Step(int32_t pos_counts, int32_t* ref_rpm, int32_t* dref_rpm_s)
+{
+	if (POSITION_REQUEST)
+	{
+		if (POSITION_REQUEST == 1)
+			Position_MoveTo(POSITION_TARGET, POSITION_VMAX_RPM, POSITION_ACCEL_RPM_S);
+		else
+			Position_Release();
+		POSITION_REQUEST = 0;
+	}
+	if (cmd_pending)
+	{
+		cmd_pending = 0;
+		apply_cmd(pos_counts, *ref_rpm);
+	}
+	if (!active)
+		return 0;
+
+	if (divider == 0)
+	{
+		divider = POSITION_DIVIDER;
+		outer_update(pos_counts);
+	}
+	divider--;
+
+	*ref_rpm    = out_rpm;
+	*dref_rpm_s = out_dref;
+	return 1;
+}
@@ -0,0 +1,199 @@
+#include "sysid.h"
+#include "controller.h"
+#include "application.h"
+#include "fixedpoint.h"
+#include <stdint.h>
+
+// This file implements on-target system identification, using ONLY integer math.
+// A PRBS (9-bit LFSR, x^9 + x^5 + 1) is added on top of the control output and
+// recursive least squares with forgetting fits
+//   v[k] = a * v[k-1] + b * u[k-1] + c * sign(v[k-1])
+// on normalised signals (velocity / RPM_SCALE and control / full scale, both Q15).
+// Parameters and covariance are kept in Q24 (64-bit covariance), which covers
+// the range from the initial covariance down to the converged values.
+// Cost per sample: ~25 64-bit multiplies and a single 64-bit division.
+//
+// From the model:
+//   U_PER_RPM = (1 - a) / b   (rescaled to Q30 per RPM)
+//   tau       = T * a / (1 - a)
+//   u_fric    = -c / b
+// and the PI gains by pole placement (IMC) for a closed-loop time constant
+// SYSID_CL_TAU_MS: Kp = tau / (K * tau_cl), Ti = tau.
+
+/* ===================== Units & scaling ===================== */
+
+#define Q24_ONE (1L << 24)
+#define VEL_SCALE 357914 // Q15_ONE / RPM_SCALE in Q16
+
+/* ===================== Config (tune in Watch) ===================== */
+
+// Set to 1 to start a run at the next control step.
+volatile int32_t SYSID_REQUEST = 0;
+
+#define SYSID_SAMPLES    1000        // Run length in control periods (10 s)
+#define SYSID_PRBS_AMP   53687091    // Excitation amplitude (Q30), 5% duty
+#define SYSID_PRBS_HOLD  2           // Control periods per PRBS bit
+#define SYSID_VMIN_RPM   20          // Below this speed the friction sign is taken as 0
+#define SYSID_CL_TAU_MS  100         // Desired closed-loop time constant for the PI design
+
+#define LAMBDA_Q24       16743223    // Forgetting factor 0.998
+#define INV_LAMBDA_Q16   65667       // 1 / 0.998
+#define P_INIT           (100LL * Q24_ONE)
+#define P_MAX            (1000LL * Q24_ONE) // Covariance windup guard
+
+/* ===================== State ===================== */
+
+static uint8_t active = 0;
+static uint32_t n = 0;
+static uint16_t lfsr = 0x1FF;
+static uint8_t hold = 0;
+static int8_t bit = 1;
+
+static uint8_t have_prev = 0;
+static int32_t prev_phi[3];      // Regressor of the previous sample (Q15)
+
+static int32_t theta[3];         // a, b, c (Q24)
+static int64_t P[3][3];          // Covariance (Q24)
+
+static sysid_result_t result;
+
+/* ===================== Helpers ===================== */
+
+// One RLS update with regressor phi (Q15) and measurement y (Q15).
+static void rls_update(const int32_t phi[3], int32_t y) {
+    int64_t Pphi[3];
+    int64_t K[3];
+
+    // Prediction error (Q24)
+    int64_t pred = 0;
+    for (int i = 0; i < 3; i++)
+        pred += (int64_t)theta[i] * phi[i];
+    const int64_t eps = (int64_t)y * (1 << 9) - (pred >> 15);
+
+    // P * phi (Q24) and phi' * P * phi (Q24)
+    int64_t s = 0;
+    for (int i = 0; i < 3; i++) {
+        Pphi[i] = (P[i][0] * phi[0] + P[i][1] * phi[1] + P[i][2] * phi[2]) >> 15;
+        s += (Pphi[i] * phi[i]) >> 15;
+    }
+
+    // Gain K = P phi / (lambda + phi' P phi), single division
+    const int64_t inv = (1LL << 48) / ((int64_t)LAMBDA_Q24 + s);
+    for (int i = 0; i < 3; i++) {
+        K[i] = (Pphi[i] * inv) >> 24;
+        theta[i] += (int32_t)((K[i] * eps) >> 24);
+    }
+
+    // P = (P - K phi' P) / lambda, kept symmetric; no 1/lambda growth past P_MAX
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            int64_t p = P[i][j] - ((K[i] * Pphi[j]) >> 24);
+            if (P[i][i] < P_MAX && P[j][j] < P_MAX)
+                p = (p * INV_LAMBDA_Q16) >> 16;
+            P[i][j] = p;
+            P[j][i] = p;
+        }
+    }
+}
+
+// Derive the motor settings from the model and apply them if plausible.
+static void finish(void) {
+    const int32_t a = theta[0], b = theta[1], c = theta[2];
+    result.a = a;
+    result.b = b;
+    result.c = c;
+
+    if (a <= 0 || a >= Q24_ONE || b <= 0) {
+        result.status = 3;
+        return;
+    }
+
+    const int64_t one_minus_a = (int64_t)Q24_ONE - a;
+    const int64_t u_per_rpm = ((1LL << 30) * one_minus_a) / ((int64_t)RPM_SCALE * b);
+    const int64_t tau_ms = ((int64_t)PERIOD_CTRL * a) / one_minus_a;
+    if (u_per_rpm <= 0 || u_per_rpm > CTRL_MAX || tau_ms <= 0) {
+        result.status = 3;
+        return;
+    }
+
+    // IMC PI: Kp = tau * U_PER_RPM / tau_cl (Q30/RPM) -> Q15 on err/RPM_SCALE
+    const int64_t kp = (tau_ms * u_per_rpm * RPM_SCALE) / ((int64_t)SYSID_CL_TAU_MS * Q15_ONE);
+    const int64_t ki = (kp * 1000LL) / tau_ms;
+
+    result.tau_ms = (uint32_t)tau_ms;
+    result.u_per_rpm = (int32_t)u_per_rpm;
+    result.u_fric = Fix_Sat30Wide(-(int64_t)c * (1LL << 30) / b);
+    result.kp = Fix_Clamp((int32_t)(kp > 32767 ? 32767 : kp), 0, 32767);
+    result.ki = Fix_Clamp((int32_t)(ki > 32767 ? 32767 : ki), 0, 32767);
+    result.status = 2;
+
+    ctrl_params_t p;
+    Controller_GetParams(&p);
+    p.u_per_rpm = result.u_per_rpm;
+    p.kp = result.kp;
+    p.ki = result.ki;
+    if (p.dob_tau_ms != 0)
+        p.dob_tau_ms = (int32_t)result.tau_ms; // Keep an enabled observer on the identified model
+    Controller_SetParams(&p);
+}
+
+/* ===================== API ===================== */
+
+void Sysid_Start(void) {
+    for (int i = 0; i < 3; i++) {
+        theta[i] = 0;
+        for (int j = 0; j < 3; j++)
+            P[i][j] = (i == j) ? P_INIT : 0;
+    }
+    n = 0;
+    hold = 0;
+    have_prev = 0;
+    result.status = 1;
+    active = 1;
+}
+
+uint8_t Sysid_IsActive(void) {
+    if (SYSID_REQUEST) {
+        SYSID_REQUEST = 0;
+        Sysid_Start();
+    }
+    return active;
+}
+
+int32_t Sysid_Step(int32_t control, int32_t meas_rpm) {
+    if (!active)
+        return control;
+
+    // Normalised velocity (Q15 of RPM_SCALE)
+    const int32_t vn = (int32_t)(((int64_t)meas_rpm * VEL_SCALE) >> 16);
+
+    if (have_prev) {
+        rls_update(prev_phi, vn);
+        if (++n >= SYSID_SAMPLES) {
+            active = 0;
+            finish();
+            return control;
+        }
+    }
+
+    // Next PRBS bit every SYSID_PRBS_HOLD samples
+    if (++hold >= SYSID_PRBS_HOLD) {
+        hold = 0;
+        const uint16_t fb = (uint16_t)((lfsr ^ (lfsr >> 4)) & 1U);
+        lfsr = (uint16_t)((lfsr >> 1) | (fb << 8));
+        bit = fb ? 1 : -1;
+    }
+    const int32_t u = Q30_Add(Q30(control), Q30(bit > 0 ? SYSID_PRBS_AMP : -SYSID_PRBS_AMP)).v;
+
+    // Regressor for the next update: v[k-1], u[k-1], sign(v[k-1])
+    prev_phi[0] = vn;
+    prev_phi[1] = u >> 15;
+    prev_phi[2] = (meas_rpm > SYSID_VMIN_RPM) ? Q15_ONE : ((meas_rpm < -SYSID_VMIN_RPM) ? -Q15_ONE : 0);
+    have_prev = 1;
+
+    return u;
+}
+
+void Sysid_GetResult(sysid_result_t* out) {
+    *out = result;
+}
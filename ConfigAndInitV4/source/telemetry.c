@@ -0,0 +1,83 @@
+/**
+ * Handles the capture of controller inputs and outputs for replay.
+ *
+ * @file telemetry.c
+ *
+ * The records go to a ring buffer in RAM. On the target, save the memory of
+ * TELEMETRY_LOG (sizeof (telemetry_log_t) bytes) as a binary file with the
+ * debugger, e.g. "dump binary memory log.tlm &TELEMETRY_LOG (&TELEMETRY_LOG)+1"
+ * in GDB; the file is a ring image log (see telemetry.h). On the host,
+ * rtos_host --telemetry drains the ring into a stream log every tick.
+ */
+
+#include "telemetry.h"
+#include "application.h"
+#include "controller.h"
+#include "stm32l4xx.h"
+#include <stdint.h>
+
+/* ----------------- State ----------------- */
+
+// Ring image, read by the debugger. 'header.count' is only advanced after the record is complete.
+telemetry_log_t TELEMETRY_LOG;
+
+static uint8_t  pending_reset = 0;
+static uint32_t last_version = 0;
+
+/* ----------------- API ----------------- */
+
+void Telemetry_Start(void)
+{
+	telemetry_header_t* h = &TELEMETRY_LOG.header;
+
+	h->count         = 0;
+	__DMB();
+	h->magic         = TELEMETRY_MAGIC;
+	h->version       = TELEMETRY_VERSION;
+	h->record_size   = (uint16_t)sizeof (telemetry_record_t);
+	h->period_ms     = PERIOD_CTRL;
+	h->law           = CONTROLLER_LAW;
+	h->capacity      = TELEMETRY_N;
+	h->param_version = Controller_GetParams(&h->params);
+
+	last_version  = h->param_version;
+	pending_reset = 1;
+}
+
+void Telemetry_Record(const telemetry_record_t* rec)
+{
+	ctrl_params_t p;
+	const uint32_t version = Controller_GetParams(&p);
+	const uint32_t n = TELEMETRY_LOG.header.count;
+	telemetry_record_t* dst = &TELEMETRY_LOG.records[n & (TELEMETRY_N - 1U)];
+
+	*dst = *rec;
+	dst->seq = n;
+	if (pending_reset)
+		dst->flags |= TELEMETRY_F_RESET;
+	if (version != last_version)
+		dst->flags |= TELEMETRY_F_PARAMS;
+	pending_reset = 0;
+	last_version  = version;
+
+	__DMB();
+	TELEMETRY_LOG.header.count = n + 1U; // Publish after the record is complete
+}
+
+uint8_t Telemetry_Get(uint32_t seq, telemetry_record_t* rec)
+{
+	const uint32_t n = TELEMETRY_LOG.header.count;
+	if (seq >= n || n - seq > TELEMETRY_N)
+		return 0;
+
+	__DMB();
+	*rec = TELEMETRY_LOG.records[seq & (TELEMETRY_N - 1U)];
+	__DMB();
+
+	return (rec->seq == seq && TELEMETRY_LOG.header.count - seq <= TELEMETRY_N); // Not overwritten while copying
+}
+
+void Telemetry_GetHeader(telemetry_header_t* header)
+{
+	*header = TELEMETRY_LOG.header;
+}
@@ -0,0 +1,284 @@
+/**
+ * Handles reference generation, evaluated incrementally once per control period.
+ *
+ * @file trajectory.c
+ *
+ * All profiles work on the reference in Q16 RPM. Ramp and table profiles add a
+ * precomputed increment per sample, sine and chirp advance a 32-bit phase
+ * accumulator and read a quarter-wave table. The S-curve is the ramp passed
+ * through a moving average of 2^TRAJ_SCURVE_SHIFT samples, which turns every
+ * acceleration step into a linear jerk phase of that length.
+ */
+
+#include "trajectory.h"
+#include "application.h"
+#include "sram2.h"
+#include <stdint.h>
+
+// The profile generator and its tables run from SRAM2 when CTRL_IN_SRAM2 is set.
+SRAM2_BEGIN
+
+/* ----------------- Units & scaling ----------------- */
+
+#define REF_Q        16
+#define SAMPLES_PER_S (1000 / PERIOD_CTRL)
+#define TWO_PI_Q16   411775                  // 2*pi in Q16
+#define SMOOTH_LEN   (1U << TRAJ_SCURVE_SHIFT)
+
+enum { PROFILE_RAMP, PROFILE_SCURVE, PROFILE_SINE, PROFILE_CHIRP, PROFILE_TABLE };
+
+// Quarter sine wave in Q15, 64 steps plus two guard entries for interpolation.
+static const int16_t sine_q15[66] = {
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,
+     8739,  9512, 10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151,
+    16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594, 23170,
+    23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510,
+    28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113, 31356, 31580, 31785,
+    31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767, 32767,
+};
+
+/* ----------------- Command (written by other threads) ----------------- */
+
+typedef struct {
+	uint8_t profile;
+	int32_t target_rpm;            // Ramp/S-curve target, sine/chirp offset
+	int32_t accel_rpm_s;           // Ramp/S-curve slope
+	int32_t amp_rpm;               // Sine/chirp amplitude
+	uint32_t f0_mhz, f1_mhz;       // Sine/chirp frequency
+	uint32_t duration_ms;          // Chirp sweep time
+	const traj_point_t* table;
+	uint16_t length;
+	uint8_t loop;
+} traj_cmd_t;
+
+static volatile traj_cmd_t cmd;
+static volatile uint8_t cmd_pending = 0;
+
+/* ----------------- State (owned by Trajectory_Step) ----------------- */
+
+static uint8_t profile = PROFILE_RAMP;
+static int32_t pos      = 0;     // Unsmoothed reference (Q16 RPM)
+static int32_t out      = 0;     // Last output reference (Q16 RPM)
+
+static int32_t target   = 0;     // Ramp target (Q16 RPM)
+static int32_t step     = 0;     // Ramp increment per sample (Q16 RPM)
+
+static uint8_t smooth   = 0;     // S-curve moving average active
+static int32_t hist[SMOOTH_LEN];
+static int64_t hist_sum = 0;
+static uint8_t hist_idx = 0;
+
+static int32_t offset   = 0;     // Sine centre (Q16 RPM)
+static int32_t amp      = 0;     // Sine amplitude (RPM)
+static uint32_t phase   = 0;     // Full turn = 2^32
+static uint32_t inc     = 0;     // Phase increment per sample
+static int32_t inc_step = 0;     // Chirp: change of inc per sample
+static uint32_t chirp_n = 0;     // Chirp: samples left in the sweep
+
+static const traj_point_t* tab = 0;
+static uint16_t tab_len = 0, tab_idx = 0;
+static uint8_t tab_loop = 0;
+static uint32_t seg_n   = 0;     // Samples left in the current segment
+
+/* ----------------- Helpers ----------------- */
+
+// Sine of a 32-bit phase in Q15, quarter-wave table with linear interpolation.
+static inline int32_t sin_q15(uint32_t ph)
+{
+	const uint32_t quadrant = ph >> 30;
+	uint32_t x = ph & 0x3FFFFFFFU;
+	if (quadrant & 1U)
+		x = 0x40000000U - x; // Mirror on the falling quarters
+
+	const uint32_t idx  = x >> 24;
+	const int32_t frac  = (int32_t)((x >> 8) & 0xFFFFU);
+	const int32_t v     = sine_q15[idx] + (((sine_q15[idx + 1] - sine_q15[idx]) * frac) >> 16);
+
+	return (quadrant & 2U) ? -v : v;
+}
+
+// Phase increment per sample for a frequency in millihertz.
+static inline uint32_t mhz_to_inc(uint32_t f_mhz)
+{
+	return (uint32_t)(((uint64_t)f_mhz << 32) / (1000000ULL / PERIOD_CTRL));
+}
+
+// Start a new profile from the current output, so the reference stays continuous.
+static void apply_cmd(void)
+{
+	const traj_cmd_t c = cmd;
+
+	if (c.profile == PROFILE_SCURVE && !smooth)
+	{
+		for (uint32_t i = 0; i < SMOOTH_LEN; i++)
+			hist[i] = out;
+		hist_sum = (int64_t)out * SMOOTH_LEN;
+		smooth = 1;
+	}
+	else if (c.profile != PROFILE_SCURVE)
+	{
+		smooth = 0;
+	}
+	pos = out;
+
+	switch (c.profile)
+	{
+		case PROFILE_RAMP:
+		case PROFILE_SCURVE:
+			target = c.target_rpm * (1 << REF_Q);
+			step   = (int32_t)((int64_t)c.accel_rpm_s * (1 << REF_Q) / SAMPLES_PER_S);
+			break;
+
+		case PROFILE_SINE:
+		case PROFILE_CHIRP:
+			offset   = c.target_rpm * (1 << REF_Q);
+			amp      = c.amp_rpm;
+			phase    = 0;
+			inc      = mhz_to_inc(c.f0_mhz);
+			chirp_n  = (c.profile == PROFILE_CHIRP) ? c.duration_ms / PERIOD_CTRL : 0;
+			inc_step = chirp_n ? (int32_t)(((int64_t)mhz_to_inc(c.f1_mhz) - (int64_t)inc) / (int64_t)chirp_n) : 0;
+			break;
+
+		case PROFILE_TABLE:
+			tab      = c.table;
+			tab_len  = c.length;
+			tab_idx  = 0;
+			tab_loop = c.loop;
+			seg_n    = 0;
+			break;
+	}
+	profile = c.profile;
+}
+
+// Post a command for the control thread (same pattern as Controller_SetParams).
+static void post_cmd(const traj_cmd_t* c)
+{
+	cmd_pending = 0;
+	cmd = *c;
+	cmd_pending = 1;
+}
+
+/* ----------------- API ----------------- */
+
+void Trajectory_Ramp(int32_t target_rpm, int32_t accel_rpm_s)
+{
+	post_cmd(&(traj_cmd_t){ .profile = PROFILE_RAMP, .target_rpm = target_rpm, .accel_rpm_s = accel_rpm_s });
+}
+
+void Trajectory_SCurve(int32_t target_rpm, int32_t accel_rpm_s)
+{
+	post_cmd(&(traj_cmd_t){ .profile = PROFILE_SCURVE, .target_rpm = target_rpm, .accel_rpm_s = accel_rpm_s });
+}
+
+void Trajectory_Sine(int32_t offset_rpm, int32_t amp_rpm, uint32_t freq_mhz)
+{
+	post_cmd(&(traj_cmd_t){ .profile = PROFILE_SINE, .target_rpm = offset_rpm, .amp_rpm = amp_rpm, .f0_mhz = freq_mhz });
+}
+
+void Trajectory_Chirp(int32_t offset_rpm, int32_t amp_rpm, uint32_t f0_mhz, uint32_t f1_mhz, uint32_t duration_ms)
+{
+	post_cmd(&(traj_cmd_t){ .profile = PROFILE_CHIRP, .target_rpm = offset_rpm, .amp_rpm = amp_rpm,
+	                        .f0_mhz = f0_mhz, .f1_mhz = f1_mhz, .duration_ms = duration_ms });
+}
+
+void Trajectory_Table(const traj_point_t* table, uint16_t length, uint8_t loop)
+{
+	post_cmd(&(traj_cmd_t){ .profile = PROFILE_TABLE, .table = table, .length = length, .loop = loop });
+}
+
+void Trajectory_Seed(int32_t ref_rpm)
+{
+	pos = ref_rpm * (1 << REF_Q);
+	out = pos;
+	if (smooth)
+	{
+		for (uint32_t i = 0; i < SMOOTH_LEN; i++)
+			hist[i] = out;
+		hist_sum = (int64_t)out * SMOOTH_LEN;
+	}
+}
+
+void Trajectory_Step(int32_t* ref_rpm, int32_t* dref_rpm_s)
+{
+	if (cmd_pending)
+	{
+		cmd_pending = 0;
+		apply_cmd();
+	}
+
+	const int32_t prev = out;
+	int32_t dref = 0;
+	uint8_t analytic = 0;
+
+	switch (profile)
+	{
+		case PROFILE_RAMP:
+		case PROFILE_SCURVE:
+			if (pos < target)
+				pos = (target - pos > step) ? pos + step : target;
+			else if (pos > target)
+				pos = (pos - target > step) ? pos - step : target;
+			break;
+
+		case PROFILE_SINE:
+		case PROFILE_CHIRP:
+		{
+			// Derivative = amp * omega * cos(phase), omega = 2*pi * inc/2^32 * samples per second
+			const int32_t omega_q16 = (int32_t)(((uint64_t)inc * TWO_PI_Q16 * SAMPLES_PER_S) >> 32);
+			pos  = offset + (int32_t)((int64_t)amp * sin_q15(phase) * 2);
+			dref = (int32_t)(((int64_t)((amp * sin_q15(phase + 0x40000000U)) >> 15) * omega_q16) >> 16);
+			analytic = 1;
+
+			phase += inc;
+			if (chirp_n)
+			{
+				inc += (uint32_t)inc_step;
+				chirp_n--;
+			}
+			break;
+		}
+
+		case PROFILE_TABLE:
+			if (seg_n == 0 && tab_idx < tab_len)
+			{
+				// Next segment: precompute the per-sample increment once
+				seg_n  = tab[tab_idx].ms / PERIOD_CTRL;
+				if (seg_n == 0)
+					seg_n = 1;
+				target = (int32_t)tab[tab_idx].rpm * (1 << REF_Q);
+				step   = (target - pos) / (int32_t)seg_n;
+			}
+			if (seg_n)
+			{
+				pos += step;
+				if (--seg_n == 0)
+				{
+					pos = target; // Land exactly on the point
+					if (++tab_idx >= tab_len && tab_loop)
+						tab_idx = 0;
+				}
+			}
+			break;
+	}
+
+	if (smooth)
+	{
+		hist_sum += (int64_t)pos - hist[hist_idx];
+		hist[hist_idx] = pos;
+		hist_idx = (uint8_t)((hist_idx + 1U) & (SMOOTH_LEN - 1U));
+		out = (int32_t)(hist_sum >> TRAJ_SCURVE_SHIFT);
+	}
+	else
+	{
+		out = pos;
+	}
+
+	// Piecewise-linear profiles: the sample difference is the exact slope
+	if (!analytic)
+		dref = (int32_t)(((int64_t)(out - prev) * SAMPLES_PER_S) >> REF_Q);
+
+	*ref_rpm    = out >> REF_Q;
+	*dref_rpm_s = dref;
+}
+
+SRAM2_END